@@ -17,23 +17,26 @@
 static const char* VS_SRC = R"(#version 330 core
 layout(location=0) in vec3 aPos;
 layout(location=1) in vec3 aNrm;
-uniform mat4 uModel,uView,uProj;
+// CV@Ρ]std140AjwI 0FPն FrameUniforms ۦPƦC^
+layout(std140) uniform Frame { mat4 view; mat4 projection; vec4 cameraPos; vec4 lightDir; };
+uniform mat4 model;
+uniform mat3 normalMatrix; // CPU n transpose(inverse(mat3(model)))
 out vec3 vN; out vec3 vWPos;
 void main(){
-  vec4 wpos = uModel * vec4(aPos,1.0);
+  vec4 wpos = model * vec4(aPos,1.0);
   vWPos = wpos.xyz;
-  vN = mat3(transpose(inverse(uModel))) * aNrm;
-  gl_Position = uProj * uView * wpos;
+  vN = normalMatrix * aNrm;
+  gl_Position = projection * view * wpos;
 })";
 
 static const char* FS_SRC = R"(#version 330 core
 in vec3 vN; in vec3 vWPos;
-uniform vec3 uCamPos;
+layout(std140) uniform Frame { mat4 view; mat4 projection; vec4 cameraPos; vec4 lightDir; };
 out vec4 FragColor;
 void main(){
   vec3 N = normalize(vN);
-  vec3 L = normalize(vec3(0.7,1.0,0.5));
-  vec3 V = normalize(uCamPos - vWPos);
+  vec3 L = normalize(-lightDir.xyz);
+  vec3 V = normalize(cameraPos.xyz - vWPos);
   vec3 H = normalize(L+V);
   float diff = max(dot(N,L),0.0);
   float spec = pow(max(dot(N,H),0.0), 32.0);
@@ -178,10 +181,20 @@ int main(int argc, char** argv) {
     glfwSwapInterval(1);
 
     GLuint prog = link(compile(GL_VERTEX_SHADER, VS_SRC), compile(GL_FRAGMENT_SHADER, FS_SRC));
-    GLint uM = glGetUniformLocation(prog, "uModel");
-    GLint uV = glGetUniformLocation(prog, "uView");
-    GLint uP = glGetUniformLocation(prog, "uProj");
-    GLint uC = glGetUniformLocation(prog, "uCamPos");
+    GLint uM = glGetUniformLocation(prog, "model");
+    GLint uN = glGetUniformLocation(prog, "normalMatrix");
+
+    // Frame blockGview / projection / ۾m / uVACVWǤ@
+    struct FrameBlock { glm::mat4 view, projection; glm::vec4 cameraPos, lightDir; };
+    static_assert(sizeof(FrameBlock) == 160, "Frame block must match std140 layout");
+    const GLuint kFrameBinding = 0;
+    GLuint frameUbo;
+    glGenBuffers(1, &frameUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kFrameBinding, frameUbo);
+    GLuint frameIndex = glGetUniformBlockIndex(prog, "Frame");
+    if (frameIndex != GL_INVALID_INDEX) glUniformBlockBinding(prog, frameIndex, kFrameBinding);
 
     std::string path = (argc > 1) ? argv[1] : std::string("Dino.obj");
     Mesh mesh;
@@ -253,9 +266,12 @@ int main(int argc, char** argv) {
         glEnable(GL_DEPTH_TEST);
         glUseProgram(prog); // s shader program
         glUniformMatrix4fv(uM, 1, GL_FALSE, &M[0][0]);
-        glUniformMatrix4fv(uV, 1, GL_FALSE, &V[0][0]);
-        glUniformMatrix4fv(uP, 1, GL_FALSE, &P[0][0]);
-        glUniform3f(uC, cam.x, cam.y, cam.z);
+        // kux}b CPU nAshader Dϯx}
+        glm::mat3 N = glm::transpose(glm::inverse(glm::mat3(M)));
+        glUniformMatrix3fv(uN, 1, GL_FALSE, &N[0][0]);
+        FrameBlock frame = { V, P, glm::vec4(cam, 1.0f), glm::vec4(-0.7f, -1.0f, -0.5f, 0.0f) };
+        glBindBuffer(GL_UNIFORM_BUFFER, frameUbo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), &frame, GL_STREAM_DRAW);
         glBindVertexArray(mesh.vao);
         glDrawArrays(GL_TRIANGLES, 0, (GLsizei)mesh.count);
 
@@ -5,6 +5,10 @@
 #include <vector>
 #include <string>
 #include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 
@@ -28,7 +32,12 @@ namespace fs = std::filesystem;
 
 static void glfw_err(int code, const char *desc) { std::fprintf(stderr, "GLFW %d: %s\n", code, desc); }
 
-static void normalize_center(std::vector<float> &pos)
+// 量化頂點格式：unorm16 位置（相對 shape AABB）+ 八面體 snorm16 法線 + half UV，16 bytes
+#ifndef PACKED_VERTICES
+#define PACKED_VERTICES 1
+#endif
+
+static void normalize_center(std::vector<float> &pos, glm::vec3 &center, float &scale)
 {
     glm::vec3 mn(FLT_MAX), mx(-FLT_MAX);
     for (size_t i = 0; i < pos.size(); i += 3)
@@ -43,6 +52,8 @@ static void normalize_center(std::vector<float> &pos)
         return;
     float s = 1.0f / maxDim;
     glm::vec3 c = 0.5f * (mn + mx);
+    center = c;
+    scale = s;
     for (size_t i = 0; i < pos.size(); i += 3)
     {
         glm::vec3 p(pos[i], pos[i + 1], pos[i + 2]);
@@ -53,13 +64,273 @@ static void normalize_center(std::vector<float> &pos)
     }
 }
 
+static uint16_t half_from_float(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, 4);
+    uint32_t sign = (x >> 16) & 0x8000u;
+    int exp = (int)((x >> 23) & 0xffu) - 127 + 15;
+    uint32_t mant = x & 0x7fffffu;
+    if (exp >= 31)
+        return (uint16_t)(sign | 0x7bffu);
+    if (exp <= 0)
+    {
+        if (exp < -10)
+            return (uint16_t)sign;
+        mant |= 0x800000u;
+        return (uint16_t)(sign | ((mant + (1u << (13 - exp))) >> (14 - exp)));
+    }
+    uint32_t h = sign | ((uint32_t)exp << 10) | (mant >> 13);
+    if (mant & 0x1000u)
+        h++; // 四捨五入
+    if ((h & 0x7c00u) == 0x7c00u)
+        h = sign | 0x7bffu;
+    return (uint16_t)h;
+}
+
+static glm::vec2 oct_encode(glm::vec3 n)
+{
+    float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (sum <= 0.0f)
+        return glm::vec2(0.0f);
+    n /= sum;
+    if (n.z >= 0.0f)
+        return glm::vec2(n.x, n.y);
+    return glm::vec2((1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+// 把 8-float 交錯頂點壓成 16 bytes，回傳最大位置誤差
+static float pack_vertices(const std::vector<float> &verts, std::vector<unsigned char> &out,
+                           glm::vec3 &offset, glm::vec3 &scale)
+{
+    size_t count = verts.size() / 8;
+    glm::vec3 mn(FLT_MAX), mx(-FLT_MAX);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 p(verts[i * 8 + 0], verts[i * 8 + 1], verts[i * 8 + 2]);
+        mn = glm::min(mn, p);
+        mx = glm::max(mx, p);
+    }
+    if (count == 0)
+        mn = mx = glm::vec3(0.0f);
+    offset = mn;
+    scale = mx - mn;
+
+    float maxErr = 0.0f;
+    out.assign(count * 16, 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        const float *v = &verts[i * 8];
+        unsigned char *dst = &out[i * 16];
+
+        uint16_t q[4] = {0, 0, 0, 0};
+        glm::vec3 decoded;
+        for (int k = 0; k < 3; k++)
+        {
+            float t = scale[k] > 0.0f ? (v[k] - offset[k]) / scale[k] : 0.0f;
+            q[k] = (uint16_t)std::lround(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f);
+            decoded[k] = offset[k] + scale[k] * (q[k] / 65535.0f);
+        }
+        maxErr = std::max(maxErr, glm::length(decoded - glm::vec3(v[0], v[1], v[2])));
+        std::memcpy(dst, q, 8);
+
+        glm::vec2 e = oct_encode(glm::vec3(v[3], v[4], v[5]));
+        int16_t n[2] = {(int16_t)std::lround(e.x * 32767.0f), (int16_t)std::lround(e.y * 32767.0f)};
+        std::memcpy(dst + 8, n, 4);
+
+        uint16_t uv[2] = {half_from_float(v[6]), half_from_float(v[7])};
+        std::memcpy(dst + 12, uv, 4);
+    }
+    return maxErr;
+}
+
+// RGB / RGBA 貼圖交由驅動程式壓縮為 S3TC（DXT1 / DXT5），VRAM 約為 1/4 ~ 1/8
+#ifndef COMPRESS_TEXTURES
+#define COMPRESS_TEXTURES 1
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+static bool has_s3tc()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+            return true;
+    }
+    return false;
+}
+
+// 2x2 box filter 縮小一階（奇數邊長時夾住邊緣）
+static std::vector<unsigned char> downsample(const unsigned char *src, int w, int h, int n, int &ow, int &oh)
+{
+    ow = std::max(1, w / 2);
+    oh = std::max(1, h / 2);
+    std::vector<unsigned char> dst((size_t)ow * oh * n);
+    for (int y = 0; y < oh; ++y)
+        for (int x = 0; x < ow; ++x)
+        {
+            int x0 = std::min(2 * x, w - 1), x1 = std::min(2 * x + 1, w - 1);
+            int y0 = std::min(2 * y, h - 1), y1 = std::min(2 * y + 1, h - 1);
+            for (int c = 0; c < n; ++c)
+            {
+                int sum = src[((size_t)y0 * w + x0) * n + c] + src[((size_t)y0 * w + x1) * n + c] +
+                          src[((size_t)y1 * w + x0) * n + c] + src[((size_t)y1 * w + x1) * n + c];
+                dst[((size_t)y * ow + x) * n + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    return dst;
+}
+
+// 貼圖最大邊長，更大的圖在上傳前縮小（0 = 不限）；CMake 可依模型設定
+#ifndef MAX_TEXTURE_SIZE
+#define MAX_TEXTURE_SIZE 4096
+#endif
+
+// 可分離的 tent 濾波縮放：每個輸出對應的來源區段與權重
+struct ResizeTaps
+{
+    std::vector<int> first, count;
+    std::vector<float> weights; // 每個輸出 stride 個
+    int stride = 0;
+};
+
+static ResizeTaps resize_taps(int in, int out)
+{
+    const float scale = (float)out / in;
+    const float support = scale < 1.0f ? 1.0f / scale : 1.0f; // 以來源像素計的半徑
+    ResizeTaps t;
+    t.stride = (int)std::ceil(2.0f * support) + 1;
+    t.first.resize(out);
+    t.count.resize(out);
+    t.weights.assign((size_t)out * t.stride, 0.0f);
+    for (int i = 0; i < out; ++i)
+    {
+        const float center = (i + 0.5f) / scale - 0.5f;
+        const int first = (int)std::floor(center - support) + 1;
+        float total = 0.0f;
+        int count = 0;
+        for (int k = 0; k < t.stride; ++k)
+        {
+            float w = 1.0f - std::fabs(first + k - center) / support;
+            if (w > 0.0f)
+                count = k + 1;
+            t.weights[(size_t)i * t.stride + k] = std::max(w, 0.0f);
+            total += std::max(w, 0.0f);
+        }
+        for (int k = 0; k < count; ++k)
+            t.weights[(size_t)i * t.stride + k] /= total;
+        t.first[i] = first;
+        t.count[i] = count;
+    }
+    return t;
+}
+
+// sRGB <-> 線性查表（與校園場景的 mip_chain 相同：濾波在線性空間做）
+struct SrgbTables
+{
+    float toLinear[256];
+    static const int kEncodeSize = 16384;
+    unsigned char toSrgb[kEncodeSize + 1];
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i <= kEncodeSize; ++i)
+        {
+            float l = (float)i / kEncodeSize;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            toSrgb[i] = (unsigned char)std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255.0f);
+        }
+    }
+};
+
+static const SrgbTables &srgb_tables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+// 先水平後垂直，縮放到 ow x oh：來源列用到時才轉為線性並水平縮放，環中只保留最近 stride 列
+// （各輸出列的來源區段單調前進），垂直累加後直接寫入輸出；暫存只有數列，與原圖大小無關
+// 色彩 channel 視為 sRGB，alpha（2 / 4 channel 的最後一個）與單 channel 影像維持線性
+static std::vector<unsigned char> resize_image(const unsigned char *src, int w, int h, int n, int ow, int oh)
+{
+    const ResizeTaps ty = resize_taps(h, oh), tx = resize_taps(w, ow);
+    const SrgbTables &srgb = srgb_tables();
+    const int alpha = n == 2 || n == 4 ? n - 1 : -1;
+    auto is_color = [&](int c) { return n >= 2 && c != alpha; };
+
+    const size_t outRow = (size_t)ow * n;
+    std::vector<float> linear((size_t)w * n);
+    std::vector<float> ring((size_t)ty.stride * outRow);
+    std::vector<int> ringRow(ty.stride, -1);
+    std::vector<float> acc(outRow);
+    std::vector<unsigned char> dst((size_t)oh * outRow);
+    for (int y = 0; y < oh; ++y)
+    {
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        for (int k = 0; k < ty.count[y]; ++k)
+        {
+            const int r = std::min(std::max(ty.first[y] + k, 0), h - 1);
+            const int slot = r % ty.stride;
+            float *row = &ring[(size_t)slot * outRow];
+            if (ringRow[slot] != r)
+            {
+                const unsigned char *in = src + (size_t)r * w * n;
+                for (size_t i = 0; i < linear.size(); ++i)
+                    linear[i] = is_color((int)(i % n)) ? srgb.toLinear[in[i]] : in[i] / 255.0f;
+                for (int x = 0; x < ow; ++x)
+                    for (int c = 0; c < n; ++c)
+                    {
+                        float sum = 0.0f;
+                        for (int j = 0; j < tx.count[x]; ++j)
+                        {
+                            int sx = std::min(std::max(tx.first[x] + j, 0), w - 1);
+                            sum += tx.weights[(size_t)x * tx.stride + j] * linear[(size_t)sx * n + c];
+                        }
+                        row[(size_t)x * n + c] = sum;
+                    }
+                ringRow[slot] = r;
+            }
+            // 整列連續累加，交給編譯器向量化
+            const float wt = ty.weights[(size_t)y * ty.stride + k];
+            for (size_t i = 0; i < outRow; ++i)
+                acc[i] += wt * row[i];
+        }
+
+        unsigned char *out = &dst[(size_t)y * outRow];
+        for (size_t i = 0; i < outRow; ++i)
+        {
+            const float v = std::min(std::max(acc[i], 0.0f), 1.0f);
+            out[i] = is_color((int)(i % n)) ? srgb.toSrgb[(int)(v * SrgbTables::kEncodeSize + 0.5f)]
+                                            : (unsigned char)(v * 255.0f + 0.5f);
+        }
+    }
+    return dst;
+}
+
 struct GLTexture
 {
     GLuint id = 0;
     int w = 0, h = 0;
+    size_t bytes = 0; // 估計 VRAM（含 mip）
 };
 
-GLTexture loadTexture2D(const std::string &path)
+GLTexture loadTexture2D(const std::string &path, int maxSize = MAX_TEXTURE_SIZE)
 {
     stbi_set_flip_vertically_on_load(true);
     int w, h, n;
@@ -69,19 +340,59 @@ GLTexture loadTexture2D(const std::string &path)
         std::cerr << "Failed to load texture: " << path << "\n";
         return {};
     }
+
+    // 過大的貼圖先縮小，之後的 mip / 壓縮與 VRAM 都以縮小後的尺寸計
+    std::vector<unsigned char> resized;
+    const unsigned char *pixels = data;
+    if (maxSize > 0 && std::max(w, h) > maxSize)
+    {
+        int ow = std::max(1, (int)((long long)w * maxSize / std::max(w, h)));
+        int oh = std::max(1, (int)((long long)h * maxSize / std::max(w, h)));
+        resized = resize_image(data, w, h, n, ow, oh);
+        std::cout << "Downscaled texture: " << path << " " << w << "x" << h << " -> " << ow << "x" << oh << "\n";
+        pixels = resized.data();
+        w = ow;
+        h = oh;
+    }
     GLenum fmt = n == 1 ? GL_RED : n == 3 ? GL_RGB
                                           : GL_RGBA;
     GLuint id;
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // 縮小後 RGB 的列不一定對齊 4 bytes
+
+    static const bool s3tc = COMPRESS_TEXTURES && has_s3tc();
+    size_t bytes = 0;
+    if (s3tc && n >= 3)
+    {
+        // 壓縮格式不保證支援 glGenerateMipmap，逐階縮小後上傳
+        GLenum internal = n == 4 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        std::vector<unsigned char> level(pixels, pixels + (size_t)w * h * n);
+        int lw = w, lh = h;
+        for (GLint lod = 0;; ++lod)
+        {
+            glTexImage2D(GL_TEXTURE_2D, lod, internal, lw, lh, 0, fmt, GL_UNSIGNED_BYTE, level.data());
+            GLint size = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, lod, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            bytes += (size_t)size;
+            if (lw == 1 && lh == 1)
+                break;
+            level = downsample(level.data(), lw, lh, n, lw, lh);
+        }
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, pixels);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        bytes = (size_t)w * h * (n == 1 ? 1 : 4) * 4 / 3;
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     stbi_image_free(data);
-    return {id, w, h};
+    return {id, w, h, bytes};
 }
 
 static GLuint makeProgram(const char *vsPath, const char *fsPath)
@@ -148,7 +459,28 @@ struct DrawCall
 {
     GLuint vao = 0, vbo = 0, ebo = 0;
     GLsizei indexCount = 0;
+    GLsizei vertexCount = 0;
     int materialId = -1;
+    glm::vec3 posOffset = glm::vec3(0.0f); // 量化位置的解碼參數
+    glm::vec3 posScale = glm::vec3(1.0f);
+};
+
+// 以 (position, normal, texcoord) 索引組合合併重複頂點
+struct CornerKey
+{
+    int v, n, t;
+    bool operator==(const CornerKey &o) const { return v == o.v && n == o.n && t == o.t; }
+};
+
+struct CornerKeyHash
+{
+    size_t operator()(const CornerKey &k) const
+    {
+        size_t h = (size_t)(unsigned)k.v * 73856093u;
+        h ^= (size_t)(unsigned)k.n * 19349663u;
+        h ^= (size_t)(unsigned)k.t * 83492791u;
+        return h;
+    }
 };
 
 int main()
@@ -182,6 +514,35 @@ int main()
     fs::path shader_dir = exe_dir / "shaders";
 
     GLuint prog = makeProgram("shaders/mesh.vert", "shaders/mesh.frag");
+    // uniform location 連結後查詢一次，繪製迴圈不再以字串查詢
+    struct
+    {
+        GLint model, normalMatrix, tex, octNormalScale, posOffset, posScale;
+    } loc = {
+        glGetUniformLocation(prog, "model"),
+        glGetUniformLocation(prog, "normalMatrix"),
+        glGetUniformLocation(prog, "uTex"),
+        glGetUniformLocation(prog, "uOctNormalScale"),
+        glGetUniformLocation(prog, "uPosOffset"),
+        glGetUniformLocation(prog, "uPosScale"),
+    };
+
+    // 每幀共用的 Frame block（std140，與校園場景的 FrameUniforms 相同排列），綁定點 0
+    struct FrameBlock
+    {
+        glm::mat4 view, projection;
+        glm::vec4 cameraPos, lightDir;
+    };
+    static_assert(sizeof(FrameBlock) == 160, "Frame block must match std140 layout");
+    const GLuint kFrameBinding = 0;
+    GLuint frameUbo;
+    glGenBuffers(1, &frameUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, kFrameBinding, frameUbo);
+    GLuint frameIndex = glGetUniformBlockIndex(prog, "Frame");
+    if (frameIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(prog, frameIndex, kFrameBinding);
 
     // ------------------------------------------------------
     // 讀取模型
@@ -248,18 +609,40 @@ int main()
     }
     if (textures.empty())
         textures.push_back(loadTexture2D(base + "tiger-atlas.jpg"));
+    size_t textureBytes = 0, rawTextureBytes = 0;
+    for (const auto &t : textures)
+    {
+        textureBytes += t.bytes;
+        rawTextureBytes += (size_t)t.w * t.h * 4 * 4 / 3;
+    }
+    std::printf("Textures: %zu KB in VRAM (RGBA8 %zu KB)\n", textureBytes / 1024, rawTextureBytes / 1024);
 
     // ------------------------------------------------------
     // 建立所有 shape 的 VBO/EBO
     // ------------------------------------------------------
     std::vector<float> all_positions;
     std::vector<DrawCall> draws;
+    size_t totalCorners = 0, totalVerts = 0;
+    size_t packedBytes = 0;
+    float maxPosError = 0.0f;
+    std::unordered_map<CornerKey, unsigned int, CornerKeyHash> remap;
     for (const auto &sh : shapes)
     {
         std::vector<float> verts;
         std::vector<unsigned int> idx;
+        remap.clear();
         for (const auto &index : sh.mesh.indices)
         {
+            CornerKey key{index.vertex_index, index.normal_index, index.texcoord_index};
+            auto found = remap.find(key);
+            if (found != remap.end())
+            {
+                idx.push_back(found->second);
+                continue;
+            }
+            unsigned int newIndex = (unsigned int)(verts.size() / 8);
+            remap.emplace(key, newIndex);
+
             glm::vec3 p(0);
             if (index.vertex_index >= 0)
             {
@@ -281,7 +664,7 @@ int main()
                 uv.y = attrib.texcoords[2 * index.texcoord_index + 1];
             }
             verts.insert(verts.end(), {p.x, p.y, p.z, n.x, n.y, n.z, uv.x, uv.y});
-            idx.push_back(idx.size());
+            idx.push_back(newIndex);
             all_positions.push_back(p.x);
             all_positions.push_back(p.y);
             all_positions.push_back(p.z);
@@ -292,33 +675,74 @@ int main()
         glBindVertexArray(d.vao);
         glGenBuffers(1, &d.vbo);
         glBindBuffer(GL_ARRAY_BUFFER, d.vbo);
-        glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
+        if (PACKED_VERTICES)
+        {
+            std::vector<unsigned char> packed;
+            maxPosError = std::max(maxPosError, pack_vertices(verts, packed, d.posOffset, d.posScale));
+            packedBytes += packed.size();
+            glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+        }
+        else
+            glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
         glGenBuffers(1, &d.ebo);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, d.ebo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(unsigned int), idx.data(), GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void *)0);
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void *)(sizeof(float) * 3));
         glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void *)(sizeof(float) * 6));
+        if (PACKED_VERTICES)
+        {
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 16, (void *)0);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, 16, (void *)8);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, 16, (void *)12);
+        }
+        else
+        {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void *)0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void *)(sizeof(float) * 3));
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void *)(sizeof(float) * 6));
+        }
         d.indexCount = (GLsizei)idx.size();
+        d.vertexCount = (GLsizei)(verts.size() / 8);
+        totalCorners += idx.size();
+        totalVerts += d.vertexCount;
         d.materialId = sh.mesh.material_ids.empty() ? -1 : sh.mesh.material_ids[0];
         draws.push_back(d);
     }
 
+    if (totalVerts > 0)
+        std::printf("Welded vertices: %zu -> %zu (x%.2f), upload saved %.2f MB\n",
+                    totalCorners, totalVerts, (double)totalCorners / totalVerts,
+                    (double)(totalCorners - totalVerts) * 8 * sizeof(float) / (1024.0 * 1024.0));
+
     // 整體 normalize 一次
-    normalize_center(all_positions);
+    glm::vec3 center(0.0f);
+    float scale = 1.0f;
+    normalize_center(all_positions, center, scale);
+
+    if (PACKED_VERTICES)
+    {
+        // 量化位置只需調整解碼參數，不必改寫 VBO
+        for (auto &d : draws)
+        {
+            d.posOffset = (d.posOffset - center) * scale;
+            d.posScale *= scale;
+        }
+        std::printf("Packed vertices: %zu KB -> %zu KB, max position error %.3g (normalized units)\n",
+                    totalVerts * 8 * sizeof(float) / 1024, packedBytes / 1024, maxPosError * scale);
+    }
 
     // 把新位置寫回各 VBO
     size_t pos_i = 0;
     for (const auto &d : draws)
     {
+        if (PACKED_VERTICES)
+            break;
         glBindBuffer(GL_ARRAY_BUFFER, d.vbo);
         float *buf = (float *)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
         if (buf)
         {
-            for (int i = 0; i < d.indexCount; i++)
+            for (int i = 0; i < d.vertexCount; i++)
             {
                 buf[i * 8 + 0] = all_positions[pos_i++];
                 buf[i * 8 + 1] = all_positions[pos_i++];
@@ -328,6 +752,10 @@ int main()
         }
     }
 
+    // 依材質排序（上面寫回 VBO 需要原本順序），繪製時只在貼圖改變時重新綁定
+    std::stable_sort(draws.begin(), draws.end(), [](const DrawCall &a, const DrawCall &b)
+                     { return a.materialId < b.materialId; });
+
     // ------------------------------------------------------
     // 渲染
     // ------------------------------------------------------
@@ -336,6 +764,13 @@ int main()
     double lastx = 0, lasty = 0;
     bool dragging = false;
 
+    // 滾輪縮放（callback 只需註冊一次）
+    glfwSetWindowUserPointer(win, &cam);
+    glfwSetScrollCallback(win, [](GLFWwindow *w, double xoff, double yoff)
+                          {
+        OrbitCamera* cam = (OrbitCamera*)glfwGetWindowUserPointer(w);
+        cam->zoom((float)yoff); });
+
     while (!glfwWindowShouldClose(win))
     {
         glfwPollEvents();
@@ -360,14 +795,6 @@ int main()
         else
             dragging = false;
 
-        // 滾輪縮放
-        double scrollY = 0.0;
-        glfwSetScrollCallback(win, [](GLFWwindow *w, double xoff, double yoff)
-                              {
-        OrbitCamera* cam = (OrbitCamera*)glfwGetWindowUserPointer(w);
-        cam->zoom((float)yoff); });
-        glfwSetWindowUserPointer(win, &cam);
-
         int w, h;
         glfwGetFramebufferSize(win, &w, &h);
         glViewport(0, 0, w, h);
@@ -409,20 +836,31 @@ int main()
                                        0.01f, 50.0f);
 
         glUseProgram(prog);
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uModel"), 1, GL_FALSE, &model[0][0]);
+        glUniformMatrix4fv(loc.model, 1, GL_FALSE, &model[0][0]);
+        // 法線矩陣在 CPU 每幀算一次，shader 內不求反矩陣
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        glUniformMatrix3fv(loc.normalMatrix, 1, GL_FALSE, &normalMatrix[0][0]);
 
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uView"), 1, GL_FALSE, &V[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uProj"), 1, GL_FALSE, &P[0][0]);
+        // 整塊重新配置（orphan），避免等待上一幀仍在使用的內容
+        FrameBlock frame = {V, P, glm::inverse(V)[3], glm::vec4(-0.6f, -0.7f, -0.5f, 0.0f)};
+        glBindBuffer(GL_UNIFORM_BUFFER, frameUbo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), &frame, GL_STREAM_DRAW);
 
-        glm::vec3 camPos = glm::vec3(glm::inverse(V)[3]);
-        glUniform3fv(glGetUniformLocation(prog, "uCam"), 1, &camPos[0]);
-        glUniform1i(glGetUniformLocation(prog, "uTex"), 0);
+        glUniform1i(loc.tex, 0);
+        glUniform1f(loc.octNormalScale, PACKED_VERTICES ? 1.0f / 32767.0f : 0.0f);
 
+        glActiveTexture(GL_TEXTURE0);
+        GLuint boundTex = ~0u; // 尚未綁定
         for (const auto &d : draws)
         {
             int mid = d.materialId >= 0 ? d.materialId : 0;
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, textures[mid].id);
+            if (textures[mid].id != boundTex)
+            {
+                boundTex = textures[mid].id;
+                glBindTexture(GL_TEXTURE_2D, boundTex);
+            }
+            glUniform3fv(loc.posOffset, 1, &d.posOffset[0]);
+            glUniform3fv(loc.posScale, 1, &d.posScale[0]);
             glBindVertexArray(d.vao);
             glDrawElements(GL_TRIANGLES, d.indexCount, GL_UNSIGNED_INT, 0);
         }
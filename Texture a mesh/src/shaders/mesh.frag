@@ -6,12 +6,19 @@ in vec2 vUV;
 out vec4 oColor;
 
 uniform sampler2D uTex;
-uniform vec3 uCam;
+
+// 每幀共用（宣告需與 vertex shader 相同）
+layout(std140) uniform Frame {
+  mat4 view;
+  mat4 projection;
+  vec4 cameraPos;
+  vec4 lightDir;
+};
 
 void main(){
     vec3 N = normalize(vN);
-    vec3 L = normalize(vec3(0.6,0.7,0.5));
-    vec3 V = normalize(uCam - vWPos);
+    vec3 L = normalize(-lightDir.xyz);
+    vec3 V = normalize(cameraPos.xyz - vWPos);
     vec3 H = normalize(L+V);
 
     float diff = max(dot(N,L),0.0);
@@ -3,16 +3,37 @@ layout(location=0) in vec3 aPos;
 layout(location=1) in vec3 aNrm;
 layout(location=2) in vec2 aUV;
 
-uniform mat4 uModel, uView, uProj;
+// 每幀共用（std140，綁定點 0；與校園場景的 FrameUniforms 相同排列）
+layout(std140) uniform Frame {
+  mat4 view;
+  mat4 projection;
+  vec4 cameraPos;
+  vec4 lightDir;
+};
+
+uniform mat4 model;
+uniform mat3 normalMatrix; // CPU 算好的 transpose(inverse(mat3(model)))
+// 量化頂點解碼（未量化時 offset = 0、scale = 1、uOctNormalScale = 0）
+uniform vec3 uPosOffset = vec3(0.0);
+uniform vec3 uPosScale = vec3(1.0);
+uniform float uOctNormalScale = 0.0;
 out vec3 vN;
 out vec3 vWPos;
 out vec2 vUV;
 
+vec3 octDecode(vec2 e){
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  return normalize(n);
+}
+
 void main(){
-  vec4 wpos = uModel * vec4(aPos,1.0);
+  vec3 pos = uPosOffset + uPosScale * aPos;
+  vec3 nrm = uOctNormalScale > 0.0 ? octDecode(aNrm.xy * uOctNormalScale) : aNrm;
+  vec4 wpos = model * vec4(pos,1.0);
   vWPos = wpos.xyz;
-  // normal uses upper-left 3x3 of model (no non-uniform scale here)
-  vN = mat3(uModel) * aNrm;
+  vN = normalMatrix * nrm;
   vUV = aUV;
-  gl_Position = uProj * uView * wpos;
+  gl_Position = projection * view * wpos;
 }
@@ -10,9 +10,18 @@ in VS_OUT {
 out vec4 FragColor;
 
 uniform sampler2D uDiffuse;
+uniform sampler2DArray uDiffuseArray;
+uniform int uTextureLayer = -1; // >= 0 時改從貼圖陣列取樣
+
+// 每幀共用（FrameUniforms，綁定點 0；宣告需與 vertex shader 相同）
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 cameraPos;
+    vec4 lightDir;
+};
 
 // 白天設定
-uniform vec3 lightDir = normalize(vec3(-0.3, -1.0, -0.3));
 uniform vec3 lightColor = vec3(1.0, 1.0, 1.0);
 uniform vec3 ambientColor = vec3(0.3, 0.3, 0.3);
 
@@ -29,7 +38,7 @@ void main()
 {
     vec3 N = normalize(fs_in.Normal);
     vec3 V = normalize(fs_in.ViewDir);
-    vec3 L = normalize(-lightDir);
+    vec3 L = normalize(-lightDir.xyz);
 
     // Diffuse
     float diff = max(dot(N, L), 0.0);
@@ -39,7 +48,8 @@ void main()
     float spec = pow(max(dot(V, R), 0.0), 64.0);
 
     // Base color from texture
-    vec3 texColor = texture(uDiffuse, fs_in.TexCoord).rgb;
+    vec3 texColor = uTextureLayer >= 0 ? texture(uDiffuseArray, vec3(fs_in.TexCoord, uTextureLayer)).rgb
+                                       : texture(uDiffuse, fs_in.TexCoord).rgb;
 
     // Combine lighting
     vec3 lighting = texColor * (ambientColor + lightColor * diff) + spec * lightColor * 0.5;
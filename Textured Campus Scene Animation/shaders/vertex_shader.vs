@@ -1,12 +1,24 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 0) in vec3 aPos;    // 量化格式時為 AABB 內的 [0,1]
+layout (location = 1) in vec3 aNormal; // 量化格式時 xy 為八面體編碼
 layout (location = 2) in vec2 aTex;
 
+// 每幀共用（FrameUniforms，綁定點 0）
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 cameraPos;
+    vec4 lightDir;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix; // CPU 算好的 transpose(inverse(mat3(model)))
+
+// 頂點解碼（未量化時 offset = 0、scale = 1、uOctNormalScale = 0）
+uniform vec3 uPosOffset = vec3(0.0);
+uniform vec3 uPosScale = vec3(1.0);
+uniform float uOctNormalScale = 0.0;
 
 out VS_OUT {
     vec3 FragPos;
@@ -15,16 +27,33 @@ out VS_OUT {
     vec3 ViewDir;
 } vs_out;
 
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+    {
+        vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * s;
+    }
+    return normalize(n);
+}
+
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    vec3 pos = uPosOffset + uPosScale * aPos;
+    vec3 normal = uOctNormalScale > 0.0 ? octDecode(aNormal.xy * uOctNormalScale) : aNormal;
+
+    vec4 worldPos = model * vec4(pos, 1.0);
     vs_out.FragPos = worldPos.xyz;
-    vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;
+#ifdef PER_VERTEX_INVERSE
+    // 舊做法，僅供效能比較
+    vs_out.Normal = mat3(transpose(inverse(model))) * normal;
+#else
+    vs_out.Normal = normalMatrix * normal;
+#endif
     vs_out.TexCoord = aTex;
 
-    // 計算觀察方向（相機位置固定在原點假設）
-    vec3 camPos = vec3(inverse(view)[3]);
-    vs_out.ViewDir = normalize(camPos - worldPos.xyz);
+    vs_out.ViewDir = normalize(cameraPos.xyz - worldPos.xyz);
 
     gl_Position = projection * view * worldPos;
 }
@@ -0,0 +1,160 @@
+#include "file_util.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(other.data_), size_(other.size_), fd_(other.fd_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.fd_ = -1;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        fd_ = other.fd_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0)
+    {
+        close();
+        return false;
+    }
+    size_ = (size_t)st.st_size;
+    if (size_ == 0)
+        return true; // 空檔案無法 mmap，但仍視為有效
+
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    data_ = p;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_)
+        munmap(data_, size_);
+    if (fd_ >= 0)
+        ::close(fd_);
+    data_ = nullptr;
+    size_ = 0;
+    fd_ = -1;
+}
+
+void MappedFile::release(size_t offset, size_t length)
+{
+    if (!data_ || offset >= size_)
+        return;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = std::min(offset + length, size_);
+    end = end == size_ ? end : end / page * page;
+    if (end > begin)
+        madvise(static_cast<char*>(data_) + begin, end - begin, MADV_DONTNEED);
+}
+
+bool fileStamp(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+    std::error_code ec;
+    size = (uint64_t)fs::file_size(path, ec);
+    if (ec)
+        return false;
+    auto t = fs::last_write_time(path, ec);
+    if (ec)
+        return false;
+    mtime = (int64_t)t.time_since_epoch().count();
+    return true;
+}
+
+uint64_t peakResidentBytes()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss; // macOS 以 bytes 回報
+#else
+    return (uint64_t)usage.ru_maxrss * 1024; // Linux 以 KB 回報
+#endif
+}
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint64_t c1 = 0x87c37b91114253d5ull;
+    const uint64_t c2 = 0x4cf5ad432745937full;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = seed ^ (size * c1);
+
+    // 一次處理 8 bytes
+    size_t n = size / 8;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t k;
+        std::memcpy(&k, p + i * 8, 8);
+        k *= c1;
+        k = rotl64(k, 31);
+        k *= c2;
+        h ^= k;
+        h = rotl64(h, 27) * 5 + 0x52dce729;
+    }
+
+    // 剩餘 bytes
+    uint64_t tail = 0;
+    size_t rem = size & 7;
+    if (rem)
+    {
+        std::memcpy(&tail, p + n * 8, rem);
+        h ^= rotl64(tail * c1, 31) * c2;
+    }
+    return fmix64(h);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 唯讀記憶體映射檔案（mmap），解構時自動釋放
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+    // 已讀完的 [offset, offset + length) 歸還系統（只釋放完整涵蓋的頁），之後仍可再讀取
+    void release(size_t offset, size_t length);
+
+    bool valid() const { return data_ != nullptr || (fd_ >= 0 && size_ == 0); }
+    const char* data() const { return static_cast<const char*>(data_); }
+    size_t size() const { return size_; }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    int fd_ = -1;
+};
+
+// 檔案大小與修改時間；檔案不存在時回傳 false
+bool fileStamp(const std::string& path, uint64_t& size, int64_t& mtime);
+
+// 行程至今的最高常駐記憶體（peak RSS）；無法取得時回傳 0
+uint64_t peakResidentBytes();
+
+// 64-bit 非加密雜湊（用於快取鍵與內容比對）
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
@@ -0,0 +1,33 @@
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include <OpenGL/gl3.h>
+#include <cstddef>
+
+// std140：mat4 佔 64 bytes、vec4 佔 16 bytes，成員依宣告順序緊密排列
+static_assert(sizeof(FrameUniforms::Block) == 160, "Frame block must match std140 layout");
+static_assert(offsetof(FrameUniforms::Block, cameraPos) == 128, "Frame block must match std140 layout");
+
+const char *const FrameUniforms::kBlockName = "Frame";
+
+FrameUniforms::FrameUniforms()
+{
+    unsigned ubo;
+    glGenBuffers(1, &ubo);
+    ubo_.reset(ubo);
+    GlState::instance().bindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_STREAM_DRAW);
+    GlState::instance().bindBufferBase(GL_UNIFORM_BUFFER, kBinding, ubo);
+}
+
+void FrameUniforms::update(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPos,
+                           const glm::vec3 &lightDir)
+{
+    block_.view = view;
+    block_.projection = projection;
+    block_.cameraPos = glm::vec4(cameraPos, 1.0f);
+    block_.lightDir = glm::vec4(lightDir, 0.0f);
+
+    // 整塊重新配置（orphan），避免等待上一幀仍在使用的內容
+    GlState::instance().bindBuffer(GL_UNIFORM_BUFFER, ubo_.get());
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), &block_, GL_STREAM_DRAW);
+}
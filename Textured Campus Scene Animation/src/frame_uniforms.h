@@ -0,0 +1,32 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "gl_handle.h"
+
+// 每幀不變的 uniform 放在 std140 uniform block，一幀只上傳一次，所有 program 經同一綁定點共用
+// shader 端宣告需與 Block 的排列一致：
+//   layout(std140) uniform Frame { mat4 view; mat4 projection; vec4 cameraPos; vec4 lightDir; };
+// 需在 GL thread 呼叫
+class FrameUniforms {
+public:
+    static const unsigned kBinding = 0;
+    static const char* const kBlockName;
+
+    struct Block {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 cameraPos; // w 未使用
+        glm::vec4 lightDir;  // w 未使用
+    };
+
+    FrameUniforms();
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    void update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos,
+                const glm::vec3& lightDir);
+    const Block& block() const { return block_; }
+
+private:
+    GlBuffer ubo_;
+    Block block_;
+};
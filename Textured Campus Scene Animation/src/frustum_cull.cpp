@@ -0,0 +1,126 @@
+#include "frustum_cull.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define CULL_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CULL_NEON 1
+#endif
+
+void BoundsSoA::push(const MeshBounds &bounds)
+{
+    // 新的一組 kLanes 先整組補 0
+    if (count % kLanes == 0)
+    {
+        const size_t padded = count + kLanes;
+        for (auto *v : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius})
+            v->resize(padded, 0.0f);
+    }
+    centerX[count] = bounds.center.x;
+    centerY[count] = bounds.center.y;
+    centerZ[count] = bounds.center.z;
+    extentX[count] = bounds.extent.x;
+    extentY[count] = bounds.extent.y;
+    extentZ[count] = bounds.extent.z;
+    radius[count] = bounds.radius;
+    count++;
+}
+
+void BoundsSoA::clear()
+{
+    for (auto *v : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius})
+        v->clear();
+    count = 0;
+}
+
+Frustum::Frustum(const glm::mat4 &clip)
+{
+    // Gribb-Hartmann：由 clip 矩陣的列取出左、右、下、上、近、遠平面
+    const glm::mat4 m = glm::transpose(clip);
+    planes[0] = m[3] + m[0];
+    planes[1] = m[3] - m[0];
+    planes[2] = m[3] + m[1];
+    planes[3] = m[3] - m[1];
+    planes[4] = m[3] + m[2];
+    planes[5] = m[3] - m[2];
+    for (auto &plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+size_t cullBounds(const BoundsSoA &bounds, const Frustum &frustum, std::vector<uint8_t> &visible)
+{
+    const size_t n = bounds.count;
+    visible.resize(n);
+    size_t inside = 0;
+
+#if defined(CULL_SSE) || defined(CULL_NEON)
+    for (size_t i = 0; i < n; i += BoundsSoA::kLanes)
+    {
+#ifdef CULL_SSE
+        const __m128 cx = _mm_loadu_ps(&bounds.centerX[i]), cy = _mm_loadu_ps(&bounds.centerY[i]),
+                     cz = _mm_loadu_ps(&bounds.centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&bounds.extentX[i]), ey = _mm_loadu_ps(&bounds.extentY[i]),
+                     ez = _mm_loadu_ps(&bounds.extentZ[i]);
+        const __m128 r = _mm_loadu_ps(&bounds.radius[i]);
+        __m128 outside = _mm_setzero_ps();
+        for (const auto &p : frustum.planes)
+        {
+            const __m128 dist = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), cx), _mm_mul_ps(_mm_set1_ps(p.y), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), cz), _mm_set1_ps(p.w)));
+            const __m128 box = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(p.x)), ex), _mm_mul_ps(_mm_set1_ps(std::fabs(p.y)), ey)),
+                _mm_mul_ps(_mm_set1_ps(std::fabs(p.z)), ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, _mm_min_ps(r, box)), _mm_setzero_ps()));
+        }
+        const int mask = _mm_movemask_ps(outside);
+#else
+        const float32x4_t cx = vld1q_f32(&bounds.centerX[i]), cy = vld1q_f32(&bounds.centerY[i]),
+                          cz = vld1q_f32(&bounds.centerZ[i]);
+        const float32x4_t ex = vld1q_f32(&bounds.extentX[i]), ey = vld1q_f32(&bounds.extentY[i]),
+                          ez = vld1q_f32(&bounds.extentZ[i]);
+        const float32x4_t r = vld1q_f32(&bounds.radius[i]);
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (const auto &p : frustum.planes)
+        {
+            float32x4_t dist = vmlaq_n_f32(vdupq_n_f32(p.w), cx, p.x);
+            dist = vmlaq_n_f32(dist, cy, p.y);
+            dist = vmlaq_n_f32(dist, cz, p.z);
+            float32x4_t box = vmulq_n_f32(ex, std::fabs(p.x));
+            box = vmlaq_n_f32(box, ey, std::fabs(p.y));
+            box = vmlaq_n_f32(box, ez, std::fabs(p.z));
+            outside = vorrq_u32(outside, vcltq_f32(vaddq_f32(dist, vminq_f32(r, box)), vdupq_n_f32(0.0f)));
+        }
+        const int mask = (int)((vgetq_lane_u32(outside, 0) & 1) | (vgetq_lane_u32(outside, 1) & 2) |
+                               (vgetq_lane_u32(outside, 2) & 4) | (vgetq_lane_u32(outside, 3) & 8));
+#endif
+        const size_t lanes = std::min(BoundsSoA::kLanes, n - i);
+        for (size_t k = 0; k < lanes; k++)
+        {
+            visible[i + k] = (mask >> k & 1) ? 0 : 1;
+            inside += visible[i + k];
+        }
+    }
+#else
+    for (size_t i = 0; i < n; i++)
+    {
+        const glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+        const glm::vec3 extent(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+        bool in = true;
+        for (const auto &p : frustum.planes)
+        {
+            const float box = glm::dot(glm::abs(glm::vec3(p)), extent);
+            if (glm::dot(glm::vec3(p), center) + p.w + std::min(bounds.radius[i], box) < 0.0f)
+            {
+                in = false;
+                break;
+            }
+        }
+        visible[i] = in ? 1 : 0;
+        inside += visible[i];
+    }
+#endif
+    return inside;
+}
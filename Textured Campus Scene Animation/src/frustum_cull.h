@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "mesh_data.h"
+
+// 多個 mesh 的包圍體，以 SoA 排列供 SIMD 一次測試 kLanes 個；長度補齊到 kLanes 的倍數（補 0）
+struct BoundsSoA {
+    static const size_t kLanes = 4;
+
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> radius;
+    size_t count = 0;
+
+    void push(const MeshBounds& bounds);
+    void clear();
+};
+
+// 物件空間的六個視錐平面（法向量朝內、已正規化）
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // clip 為 projection * modelView
+    explicit Frustum(const glm::mat4& clip);
+};
+
+// 對每個包圍體寫入 visible[i]（1 = 與視錐相交或在內），回傳可見數
+// 每個平面取包圍球與 AABB 投影半徑中較小者判斷，兩者都完全在外側才剔除（保守）
+// x86 以 SSE、ARM 以 NEON 一次處理 4 個，其餘平台逐一計算
+size_t cullBounds(const BoundsSoA& bounds, const Frustum& frustum, std::vector<uint8_t>& visible);
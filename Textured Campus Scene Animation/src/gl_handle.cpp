@@ -0,0 +1,37 @@
+#include "gl_handle.h"
+#include "gl_state.h"
+#include <OpenGL/gl3.h>
+
+namespace gl_detail
+{
+
+void deleteTexture(unsigned id)
+{
+    GlState::instance().forgetTexture(id);
+    glDeleteTextures(1, &id);
+}
+
+void deleteBuffer(unsigned id)
+{
+    GlState::instance().forgetBuffer(id);
+    glDeleteBuffers(1, &id);
+}
+
+void deleteVertexArray(unsigned id)
+{
+    GlState::instance().forgetVertexArray(id);
+    glDeleteVertexArrays(1, &id);
+}
+
+void deleteProgram(unsigned id)
+{
+    GlState::instance().forgetProgram(id);
+    glDeleteProgram(id);
+}
+
+void deleteQuery(unsigned id)
+{
+    glDeleteQueries(1, &id);
+}
+
+} // namespace gl_detail
@@ -0,0 +1,56 @@
+#pragma once
+
+// 刪除函式（gl_handle.cpp，避免標頭依賴 GL）；刪除前通知 GlState
+namespace gl_detail {
+void deleteTexture(unsigned id);
+void deleteBuffer(unsigned id);
+void deleteVertexArray(unsigned id);
+void deleteProgram(unsigned id);
+void deleteQuery(unsigned id);
+} // namespace gl_detail
+
+// GL 物件名稱的 move-only 擁有者，解構或 reset 時刪除
+// 需在 GL thread、context 仍有效時釋放
+template <void (*Delete)(unsigned)>
+class GlHandle {
+public:
+    GlHandle() = default;
+    explicit GlHandle(unsigned id) : id_(id) {}
+    ~GlHandle() { reset(); }
+    GlHandle(GlHandle&& o) noexcept : id_(o.release()) {}
+    GlHandle& operator=(GlHandle&& o) noexcept
+    {
+        if (this != &o)
+            reset(o.release());
+        return *this;
+    }
+    GlHandle(const GlHandle&) = delete;
+    GlHandle& operator=(const GlHandle&) = delete;
+
+    unsigned get() const { return id_; }
+    explicit operator bool() const { return id_ != 0; }
+
+    // 放棄擁有權並回傳名稱
+    unsigned release()
+    {
+        const unsigned id = id_;
+        id_ = 0;
+        return id;
+    }
+    // 刪除目前的物件並改為擁有 id
+    void reset(unsigned id = 0)
+    {
+        if (id_ && id_ != id)
+            Delete(id_);
+        id_ = id;
+    }
+
+private:
+    unsigned id_ = 0;
+};
+
+using GlTexture = GlHandle<gl_detail::deleteTexture>;
+using GlBuffer = GlHandle<gl_detail::deleteBuffer>;
+using GlVertexArray = GlHandle<gl_detail::deleteVertexArray>;
+using GlProgram = GlHandle<gl_detail::deleteProgram>;
+using GlQuery = GlHandle<gl_detail::deleteQuery>;
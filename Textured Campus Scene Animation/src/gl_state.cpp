@@ -0,0 +1,148 @@
+#include "gl_state.h"
+#include <OpenGL/gl3.h>
+
+GlState &GlState::instance()
+{
+    static GlState state;
+    return state;
+}
+
+GlState::GlState() = default;
+
+bool GlState::change(unsigned &value, unsigned want)
+{
+    if (value == want)
+    {
+        frame_.skipped++;
+        return false;
+    }
+    value = want;
+    frame_.issued++;
+    return true;
+}
+
+unsigned *GlState::bufferSlot(unsigned target)
+{
+    return &buffers_.emplace(target, kUnknown).first->second;
+}
+
+unsigned *GlState::textureSlot(int unit, unsigned target)
+{
+    if (unit < 0 || unit >= kTextureUnits)
+        return nullptr;
+    switch (target)
+    {
+    case GL_TEXTURE_2D:
+        return &units_[unit].texture2D;
+    case GL_TEXTURE_2D_ARRAY:
+        return &units_[unit].textureArray;
+    default:
+        return nullptr;
+    }
+}
+
+void GlState::useProgram(unsigned program)
+{
+    if (change(program_, program))
+        glUseProgram(program);
+}
+
+void GlState::bindVertexArray(unsigned vao)
+{
+    if (change(vao_, vao))
+    {
+        glBindVertexArray(vao);
+        *bufferSlot(GL_ELEMENT_ARRAY_BUFFER) = kUnknown;
+    }
+}
+
+bool GlState::bindTexture(int unit, unsigned target, unsigned texture)
+{
+    // 之後的 glTex* 作用在 active unit 上，即使不必重新綁定也要切過去
+    if (change(activeUnit_, GL_TEXTURE0 + unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    unsigned *slot = textureSlot(unit, target);
+    if (slot && !change(*slot, texture))
+        return false;
+    if (!slot)
+        frame_.issued++;
+    glBindTexture(target, texture);
+    return true;
+}
+
+void GlState::bindBuffer(unsigned target, unsigned buffer)
+{
+    if (change(*bufferSlot(target), buffer))
+        glBindBuffer(target, buffer);
+}
+
+void GlState::bindBufferBase(unsigned target, unsigned index, unsigned buffer)
+{
+    frame_.issued++;
+    glBindBufferBase(target, index, buffer);
+    *bufferSlot(target) = buffer;
+}
+
+void GlState::setEnabled(unsigned capability, bool on)
+{
+    unsigned &value = enabled_.emplace(capability, kUnknown).first->second;
+    if (!change(value, on ? 1u : 0u))
+        return;
+    if (on)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GlState::forgetProgram(unsigned program)
+{
+    // 使用中的 program 刪除後仍有效到換掉為止，保守起見改為未知
+    if (program_ == program)
+        program_ = kUnknown;
+}
+
+void GlState::forgetVertexArray(unsigned vao)
+{
+    if (vao_ == vao)
+    {
+        vao_ = 0;
+        *bufferSlot(GL_ELEMENT_ARRAY_BUFFER) = kUnknown;
+    }
+}
+
+void GlState::forgetTexture(unsigned texture)
+{
+    for (auto &unit : units_)
+    {
+        if (unit.texture2D == texture)
+            unit.texture2D = 0;
+        if (unit.textureArray == texture)
+            unit.textureArray = 0;
+    }
+}
+
+void GlState::forgetBuffer(unsigned buffer)
+{
+    for (auto &binding : buffers_)
+    {
+        if (binding.second == buffer)
+            binding.second = 0;
+    }
+}
+
+void GlState::invalidate()
+{
+    program_ = kUnknown;
+    vao_ = kUnknown;
+    activeUnit_ = kUnknown;
+    for (auto &unit : units_)
+        unit = TextureUnit();
+    buffers_.clear();
+    enabled_.clear();
+}
+
+void GlState::beginFrame()
+{
+    lastFrame_ = frame_;
+    frame_ = GlStateStats();
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <map>
+
+// 一幀內經由 GlState 的狀態變更呼叫數
+struct GlStateStats {
+    uint64_t issued = 0;  // 實際送給 GL
+    uint64_t skipped = 0; // 與目前狀態相同而省略
+};
+
+// 記錄 program、VAO、各 texture unit、buffer 綁定與 glEnable 位元的目前值，相同時不呼叫 GL
+// 只有全部經由這裡變更狀態時快取才正確：直接呼叫 GL 改變狀態的程式碼之後需呼叫 invalidate()
+// GlHandle 刪除物件時會通知（名稱可能被重複使用）。需在 GL thread 呼叫
+class GlState {
+public:
+    static const int kTextureUnits = 16;
+
+    static GlState& instance();
+
+    void useProgram(unsigned program);
+    void bindVertexArray(unsigned vao);
+    // 回傳是否實際綁定；unit 同時成為 active unit（之後的 glTex* 作用在它上）
+    bool bindTexture(int unit, unsigned target, unsigned texture);
+    // GL_ELEMENT_ARRAY_BUFFER 屬於 VAO 狀態，換 VAO 後重新追蹤
+    void bindBuffer(unsigned target, unsigned buffer);
+    // 綁定 indexed 目標（一定送出），同時記錄它對一般綁定點的副作用
+    void bindBufferBase(unsigned target, unsigned index, unsigned buffer);
+    void setEnabled(unsigned capability, bool on);
+
+    // 物件刪除後，GL 會把指向它的綁定改回 0
+    void forgetProgram(unsigned program);
+    void forgetVertexArray(unsigned vao);
+    void forgetTexture(unsigned texture);
+    void forgetBuffer(unsigned buffer);
+
+    // 所有狀態改為未知，下次設定一定送出
+    void invalidate();
+
+    // 每幀開始呼叫：目前的計數移到 lastFrame
+    void beginFrame();
+    const GlStateStats& lastFrame() const { return lastFrame_; }
+
+private:
+    static constexpr unsigned kUnknown = ~0u;
+
+    struct TextureUnit {
+        unsigned texture2D = kUnknown;
+        unsigned textureArray = kUnknown;
+    };
+
+    GlState();
+    // value 與 want 相同時計入 skipped 並回傳 false；否則記錄新值並回傳 true
+    bool change(unsigned& value, unsigned want);
+    unsigned* bufferSlot(unsigned target);
+    unsigned* textureSlot(int unit, unsigned target);
+
+    unsigned program_ = kUnknown;
+    unsigned vao_ = kUnknown;
+    unsigned activeUnit_ = kUnknown;
+    TextureUnit units_[kTextureUnits];
+    std::map<unsigned, unsigned> buffers_;  // target -> buffer
+    std::map<unsigned, unsigned> enabled_;  // capability -> 0 / 1
+    GlStateStats frame_, lastFrame_;
+};
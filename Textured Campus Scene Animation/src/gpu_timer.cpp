@@ -0,0 +1,56 @@
+#include "gpu_timer.h"
+#include <OpenGL/gl3.h>
+
+GpuTimer::GpuTimer()
+{
+    for (auto &query : queries_)
+    {
+        unsigned id;
+        glGenQueries(1, &id);
+        query.reset(id);
+    }
+}
+
+void GpuTimer::collect()
+{
+    for (int i = 0; i < kQueries; i++)
+    {
+        if (!pending_[i])
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries_[i].get(), GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries_[i].get(), GL_QUERY_RESULT, &ns);
+        pending_[i] = false;
+        totalNs_ += ns;
+        samples_++;
+    }
+}
+
+void GpuTimer::begin()
+{
+    collect();
+    // 環中下一個 query 的結果還沒回來：跳過這一幀
+    active_ = !pending_[next_];
+    if (active_)
+        glBeginQuery(GL_TIME_ELAPSED, queries_[next_].get());
+}
+
+void GpuTimer::end()
+{
+    if (!active_)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    pending_[next_] = true;
+    next_ = (next_ + 1) % kQueries;
+    active_ = false;
+}
+
+void GpuTimer::reset()
+{
+    // 進行中的 query 結果仍會在之後計入
+    totalNs_ = 0;
+    samples_ = 0;
+}
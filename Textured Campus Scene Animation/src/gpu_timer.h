@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include "gl_handle.h"
+
+// 以 GL_TIME_ELAPSED query 量測 begin / end 之間 GL 命令的 GPU 時間
+// 結果在數幀後才讀取，不會讓 CPU 等待 GPU；所有 query 都還在等結果時該幀不量測
+// 需在 GL thread 呼叫，同一時間只能有一個 GL_TIME_ELAPSED query 進行中
+class GpuTimer {
+public:
+    static const int kQueries = 4;
+
+    GpuTimer();
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void begin();
+    void end();
+
+    // 自上次 reset 以來已取得結果的量測
+    int samples() const { return samples_; }
+    double averageMs() const { return samples_ ? totalNs_ / 1e6 / samples_ : 0.0; }
+    void reset();
+
+private:
+    // 讀回已完成的 query
+    void collect();
+
+    GlQuery queries_[kQueries];
+    bool pending_[kQueries] = {};
+    int next_ = 0;
+    bool active_ = false;
+    uint64_t totalNs_ = 0;
+    int samples_ = 0;
+};
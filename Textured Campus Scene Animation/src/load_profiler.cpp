@@ -0,0 +1,120 @@
+#include "load_profiler.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+const char* loadPhaseName(LoadPhase phase)
+{
+    static const char* const kNames[] = {
+        "mesh_cache_read", "parse",        "vertex_build", "vertex_optimize", "vertex_quantize",
+        "mesh_cache_write", "texture_decode", "texture_resize", "texture_cache_read", "texture_compress",
+        "gpu_upload", "mipmap",
+    };
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == (size_t)LoadPhase::Count, "phase names");
+    return kNames[(size_t)phase];
+}
+
+LoadProfiler& LoadProfiler::instance()
+{
+    static LoadProfiler profiler;
+    return profiler;
+}
+
+void LoadProfiler::record(LoadPhase phase, const std::string& file, double ms, uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    PhaseStats& stats = files_[file][(size_t)phase];
+    stats.ms += ms;
+    stats.bytes += bytes;
+    stats.count++;
+}
+
+static std::string jsonString(const std::string& s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+            out += buf;
+        }
+        else
+            out += c;
+    }
+    return out + "\"";
+}
+
+static void writePhases(std::ostream& os, const LoadProfiler::PhaseStats* phases, const char* indent)
+{
+    os << "{";
+    bool first = true;
+    for (size_t p = 0; p < (size_t)LoadPhase::Count; p++)
+    {
+        const auto& s = phases[p];
+        if (s.count == 0)
+            continue;
+        os << (first ? "\n" : ",\n") << indent << "  " << jsonString(loadPhaseName((LoadPhase)p))
+           << ": {\"ms\": " << s.ms << ", \"bytes\": " << s.bytes << ", \"count\": " << s.count << "}";
+        first = false;
+    }
+    os << "\n" << indent << "}";
+}
+
+std::string LoadProfiler::writeReport(const std::string& jsonPath) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    FileStats totals{};
+    for (const auto& [file, stats] : files_)
+    {
+        for (size_t p = 0; p < stats.size(); p++)
+        {
+            totals[p].ms += stats[p].ms;
+            totals[p].bytes += stats[p].bytes;
+            totals[p].count += stats[p].count;
+        }
+    }
+
+    std::ofstream out(jsonPath);
+    out << "{\n  \"files\": [";
+    bool first = true;
+    for (const auto& [file, stats] : files_)
+    {
+        out << (first ? "\n" : ",\n") << "    {\"file\": " << jsonString(file) << ", \"phases\": ";
+        writePhases(out, stats.data(), "    ");
+        out << "}";
+        first = false;
+    }
+    out << "\n  ],\n  \"peak_rss_bytes\": " << peakResidentBytes() << ",\n  \"totals\": ";
+    writePhases(out, totals.data(), "  ");
+    out << "\n}\n";
+
+    std::ostringstream summary;
+    summary << "Load profile:";
+    for (size_t p = 0; p < totals.size(); p++)
+    {
+        if (totals[p].count == 0)
+            continue;
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), " %s %.1f ms (%.1f MB)", loadPhaseName((LoadPhase)p),
+                      totals[p].ms, totals[p].bytes / (1024.0 * 1024.0));
+        summary << buf;
+    }
+    summary << (out ? " -> " : " (failed to write) ") << jsonPath;
+    return summary.str();
+}
+
+ScopedPhase::~ScopedPhase()
+{
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+    LoadProfiler::instance().record(phase_, file_, std::max(ms - excludedMs_, 0.0), bytes_);
+}
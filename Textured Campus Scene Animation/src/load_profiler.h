@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// 載入流程的各階段
+enum class LoadPhase {
+    MeshCacheRead,    // 讀取 / 驗證 .meshcache
+    Parse,            // OBJ 文字解析
+    VertexBuild,      // 頂點合併與材質分段
+    VertexOptimize,   // vertex cache / fetch 重排
+    VertexQuantize,   // 量化頂點格式
+    MeshCacheWrite,   // 寫入 .meshcache
+    TextureDecode,    // 圖檔解碼（stbi_load）
+    TextureResize,    // 超過大小上限的貼圖縮小
+    TextureCacheRead, // 讀取 .texcache
+    TextureCompress,  // BC1 / BC3 壓縮
+    GpuUpload,        // glBufferSubData / glTexImage2D
+    Mipmap,           // mip 鏈產生（CPU，或退回 glGenerateMipmap）
+    Count
+};
+
+const char* loadPhaseName(LoadPhase phase);
+
+// 各檔案、各階段的累計時間與 bytes（執行緒安全）
+// GL 呼叫為非同步，GpuUpload / Mipmap 量到的是 CPU 端提交時間
+class LoadProfiler {
+public:
+    struct PhaseStats {
+        double ms = 0.0;
+        uint64_t bytes = 0;
+        uint32_t count = 0;
+    };
+
+    static LoadProfiler& instance();
+
+    void record(LoadPhase phase, const std::string& file, double ms, uint64_t bytes);
+
+    // 寫出 JSON 報告；回傳一行摘要
+    std::string writeReport(const std::string& jsonPath) const;
+
+private:
+    using FileStats = std::array<PhaseStats, (size_t)LoadPhase::Count>;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, FileStats> files_;
+};
+
+// 範圍計時器：解構時把耗時與 bytes 記入 LoadProfiler
+class ScopedPhase {
+public:
+    ScopedPhase(LoadPhase phase, std::string file)
+        : phase_(phase), file_(std::move(file)), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedPhase();
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    void addBytes(uint64_t bytes) { bytes_ += bytes; }
+    // 範圍內已另外記錄到其他階段的時間，不重複計入本階段
+    void exclude(double ms) { excludedMs_ += ms; }
+
+private:
+    LoadPhase phase_;
+    std::string file_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t bytes_ = 0;
+    double excludedMs_ = 0.0;
+};
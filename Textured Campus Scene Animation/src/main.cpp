@@ -4,12 +4,19 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <cmath>
 
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include "gpu_timer.h"
 #include "shader.h"
 #include "camera.h"
+#include "load_profiler.h"
 #include "model.h"
+#include "render_queue.h"
+#include "resource_manager.h"
 
 // -----------------------------------------------------------------------------
 // Catmull–Rom 插值
@@ -25,6 +32,20 @@ static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1,
                    (-p0 + 3.f * p1 - 3.f * p2 + p3) * t3);
 }
 
+// 每幀最多上傳的 mesh / 貼圖資料量
+static const size_t kUploadBudgetMB = 8;
+// 貼圖上傳 PBO 環大小，約可容納四幀的上傳量，GPU 落後時不必等待
+static const size_t kUploadRingMB = 32;
+// 貼圖 VRAM 預算，超過時最久未繪製的貼圖降級為小 mip
+static const uint64_t kTextureBudgetMB = 512;
+// 校園場景貼圖的最大邊長；更大的圖載入時縮小
+static const int kMaxTextureSize = 4096;
+// 沿鏡頭路徑往前預測的秒數與取樣數（提早載入屆時入鏡的貼圖）
+static const float kPrefetchSeconds = 3.0f;
+static const int kPrefetchSamples = 3;
+// 效能比較用：true 時 vertex shader 改回每個頂點計算 transpose(inverse(model))
+static const bool kPerVertexInverse = false;
+
 // -----------------------------------------------------------------------------
 // GLFW 錯誤輸出
 // -----------------------------------------------------------------------------
@@ -60,18 +81,35 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
-    glEnable(GL_DEPTH_TEST);
+    glfwSwapInterval(1);
+    GlState::instance().setEnabled(GL_DEPTH_TEST, true);
 
     glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int w, int h) {
         glViewport(0, 0, w, h);
     });
 
     // --- Shader & Model ---
-    Shader shader("shaders/vertex_shader.vs", "shaders/fragment_shader.fs");
-    shader.use();
-    shader.setInt("uDiffuse", 0);
+    // GL 資源由 ResourceManager 以參考計數管理，需在 glfwTerminate 前釋放
+    std::shared_ptr<Shader> shader = ResourceManager::instance().shader(
+        "shaders/vertex_shader.vs", "shaders/fragment_shader.fs", kPerVertexInverse ? "#define PER_VERTEX_INVERSE\n" : "");
+    std::shared_ptr<FrameUniforms> frame = ResourceManager::instance().frameUniforms();
+    shader->use();
+    shader->setInt("uDiffuse", 0);
+    shader->setInt("uDiffuseArray", 1);
 
-    Model campus("assets/SchoolSceneDay/SchoolSceneDay.obj");
+    // 背景載入：先進入主迴圈，已就緒的部分逐幀上傳
+    ModelLoadOptions loadOptions;
+    loadOptions.async = true;
+    loadOptions.streamObj = true;
+    loadOptions.compressTextures = true;
+    loadOptions.mipFilter = MipFilter::Kaiser;
+    loadOptions.textureSizes.set("assets/SchoolSceneDay", {kMaxTextureSize, 0});
+    loadOptions.textureBudgetBytes = kTextureBudgetMB << 20;
+    // 貼圖陣列不參與串流與預算，開啟 streamTextureMips / textureBudgetBytes 時不使用
+    loadOptions.textureArrays = false;
+    loadOptions.streamTextureMips = true;
+    loadOptions.uploadRingBytes = kUploadRingMB << 20;
+    auto campus = std::make_unique<Model>("assets/SchoolSceneDay/SchoolSceneDay.obj", loadOptions);
     Camera camera;
 
     // -------------------------------------------------------------------------
@@ -122,14 +160,11 @@ int main()
     float totalDuration = 0.f;
     for (auto& s : segments) totalDuration += s.duration;
     double startTime = glfwGetTime();
+    bool firstFrame = true;
 
-    // -------------------------------------------------------------------------
-    // 主迴圈
-    // -------------------------------------------------------------------------
-    while (!glfwWindowShouldClose(window))
-    {
-        double now = glfwGetTime() - startTime;
-        float tGlobal = fmodf((float)now, totalDuration);
+    // 路徑上 time 秒時的相機位置與注視點（路徑固定，也用來預測之後的鏡頭）
+    auto cameraAt = [&](float time, glm::vec3& target) {
+        float tGlobal = fmodf(time, totalDuration);
 
         // 決定目前段落
         float acc = 0.f;
@@ -151,10 +186,36 @@ int main()
         // 高度下限保護
         camPos.y = std::max(camPos.y, 0.0f);
 
-        // 注視點
-        glm::vec3 nextPos = catmullRom(path[i], path[i+1], path[i+2], path[i+3], t + 0.02f);
-        glm::vec3 desiredTarget = nextPos; // 看向移動方向
+        // 注視點：看向移動方向
+        target = catmullRom(path[i], path[i+1], path[i+2], path[i+3], t + 0.02f);
+        return camPos;
+    };
 
+    // Draw 的 CPU / GPU 時間與繪製計數（每 kDrawReportFrames 幀輸出平均）
+    const int kDrawReportFrames = 600;
+    double drawSeconds = 0.0;
+    int drawFrames = 0;
+    GlStateStats glCalls;
+    double sortSeconds = 0.0;
+    RenderQueueStats queueTotals;
+    size_t culledTotal = 0;
+    // 所有 Model 的繪製命令排序後一起送出
+    RenderQueue queue;
+    auto drawTimer = std::make_unique<GpuTimer>();
+
+    // -------------------------------------------------------------------------
+    // 主迴圈
+    // -------------------------------------------------------------------------
+    while (!glfwWindowShouldClose(window))
+    {
+        // 上一幀經由 GlState 的狀態變更呼叫數（含載入與上傳）
+        GlState::instance().beginFrame();
+        glCalls.issued += GlState::instance().lastFrame().issued;
+        glCalls.skipped += GlState::instance().lastFrame().skipped;
+
+        double now = glfwGetTime() - startTime;
+        glm::vec3 desiredTarget;
+        glm::vec3 camPos = cameraAt((float)now, desiredTarget);
 
         // 設定相機位置與注視點（直接設定）
         camera.setPosition(camPos);
@@ -178,19 +239,74 @@ int main()
         glm::mat4 proj = glm::perspective(glm::radians(45.0f), (float)fbW / fbH, 1.0f, 500.0f);
         glm::mat4 model = glm::mat4(1.0f);
 
-        shader.use();
-        shader.setMat4("view", view);
-        shader.setMat4("projection", proj);
-        shader.setMat4("model", model);
-        shader.setVec3("lightDir", sunDir);
-        glfwSwapInterval(1);
+        // view / projection / 相機 / 光源每幀只上傳一次，所有 program 共用
+        frame->update(view, proj, camPos, sunDir);
+        shader->use();
+        shader->setModel(model);
+        campus->setViewer(view * model, proj, fbH);
+
+        // 沿路徑往前取樣，提早載入之後會入鏡的貼圖
+        for (int k = 1; k <= kPrefetchSamples; ++k)
+        {
+            glm::vec3 futureTarget;
+            glm::vec3 futurePos = cameraAt((float)now + kPrefetchSeconds * k / kPrefetchSamples, futureTarget);
+            glm::mat4 futureView = glm::lookAt(futurePos, futureTarget, camera.up);
+            campus->prefetch(futureView * model, proj, fbH);
+        }
 
-        campus.Draw();
+        if (!campus->isLoaded() && campus->update(kUploadBudgetMB << 20))
+        {
+            std::cout << "Total load time: " << glfwGetTime() * 1000.0 << " ms" << std::endl;
+            std::cout << LoadProfiler::instance().writeReport("load_report.json") << std::endl;
+            ResourceManager::instance().printResources(std::cout);
+        }
+        double drawStart = glfwGetTime();
+        drawTimer->begin();
+        campus->enqueue(queue, *shader);
+        queue.submit();
+        drawTimer->end();
+        drawSeconds += glfwGetTime() - drawStart;
+        sortSeconds += queue.stats().sortMs / 1000.0;
+        queueTotals.commands += queue.stats().commands;
+        queueTotals.programChanges += queue.stats().programChanges;
+        queueTotals.vaoChanges += queue.stats().vaoChanges;
+        queueTotals.textureBinds += queue.stats().textureBinds;
+        culledTotal += campus->drawStats().culled;
+        if (++drawFrames == kDrawReportFrames)
+        {
+            const TextureStats& tex = campus->textureStats();
+            std::cout << "Draw: " << drawSeconds * 1000.0 / drawFrames << " ms CPU/frame (sort "
+                      << sortSeconds * 1000.0 / drawFrames << " ms), " << drawTimer->averageMs()
+                      << " ms GPU/frame, " << queueTotals.commands / drawFrames << " draws ("
+                      << culledTotal / drawFrames << " culled), " << queueTotals.programChanges / drawFrames
+                      << " programs, " << queueTotals.vaoChanges / drawFrames << " VAOs, "
+                      << queueTotals.textureBinds / drawFrames << " texture binds per frame, textures "
+                      << tex.residentBytes / (1024 * 1024) << " MB resident (" << tex.reloads << " streamed in, "
+                      << tex.prefetches << " prefetched, " << tex.trims << " trimmed), GL state calls "
+                      << glCalls.issued / drawFrames << " issued / " << glCalls.skipped / drawFrames
+                      << " skipped per frame" << std::endl;
+            drawSeconds = 0.0;
+            drawFrames = 0;
+            sortSeconds = 0.0;
+            queueTotals = RenderQueueStats();
+            culledTotal = 0;
+            drawTimer->reset();
+            glCalls = GlStateStats();
+        }
 
         glfwSwapBuffers(window);
+        if (firstFrame)
+        {
+            std::cout << "Time to first frame: " << glfwGetTime() * 1000.0 << " ms" << std::endl;
+            firstFrame = false;
+        }
         glfwPollEvents();
     }
 
+    campus.reset();
+    drawTimer.reset();
+    shader.reset();
+    frame.reset();
     glfwTerminate();
     return 0;
 } 
\ No newline at end of file
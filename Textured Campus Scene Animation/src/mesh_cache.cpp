@@ -0,0 +1,260 @@
+#include "mesh_cache.h"
+#include "vertex_format.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+static const char kMagic[8] = {'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H'};
+static const uint32_t kVersion = 8;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexFormat;
+    MeshCacheKey key;
+    uint32_t meshCount;
+    uint32_t flags;
+};
+
+struct MeshRecord {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+    float posOffset[3];
+    float posScale[3];
+    float boundsCenter[3];
+    float boundsRadius;
+    float uvDensity;
+    float boundsExtent[3];
+};
+
+static_assert(sizeof(MeshCacheKey) == 48, "MeshCacheKey layout");
+static_assert(sizeof(MeshRecord) == 88, "MeshRecord layout");
+
+static uint64_t alignUp(uint64_t v, uint64_t a)
+{
+    return (v + a - 1) / a * a;
+}
+
+// 找出 OBJ 中所有 mtllib 指令引用的檔名
+static std::vector<std::string> findMtlLibs(const char* data, size_t size)
+{
+    std::vector<std::string> libs;
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end)
+    {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol)
+            eol = end;
+
+        const char* s = p;
+        while (s < eol && (*s == ' ' || *s == '\t'))
+            s++;
+        if (eol - s > 7 && std::memcmp(s, "mtllib", 6) == 0 && (s[6] == ' ' || s[6] == '\t'))
+        {
+            s += 7;
+            while (s < eol)
+            {
+                while (s < eol && (*s == ' ' || *s == '\t' || *s == '\r'))
+                    s++;
+                const char* t = s;
+                while (t < eol && *t != ' ' && *t != '\t' && *t != '\r')
+                    t++;
+                if (t > s)
+                    libs.emplace_back(s, t);
+                s = t;
+            }
+        }
+        p = eol + 1;
+    }
+    return libs;
+}
+
+std::string MeshCache::pathFor(const std::string& objPath)
+{
+    return objPath + ".meshcache";
+}
+
+bool MeshCache::computeKey(const std::string& objPath, MeshCacheKey& key)
+{
+    key = MeshCacheKey{};
+    if (!fileStamp(objPath, key.objSize, key.objMtime))
+        return false;
+
+    MappedFile obj(objPath);
+    if (!obj.valid())
+        return false;
+    key.objHash = hashBytes(obj.data(), obj.size());
+
+    // MTL 以 OBJ 所在目錄為搜尋路徑（與 Model 的 tinyobj 設定一致）
+    fs::path dir = fs::path(objPath).parent_path();
+    for (const auto& lib : findMtlLibs(obj.data(), obj.size()))
+    {
+        std::string mtlPath = (dir / lib).string();
+        uint64_t size;
+        int64_t mtime;
+        if (!fileStamp(mtlPath, size, mtime))
+            continue;
+        MappedFile mtl(mtlPath);
+        if (!mtl.valid())
+            continue;
+        key.mtlSize += size;
+        key.mtlMtime = std::max(key.mtlMtime, mtime);
+        key.mtlHash = hashBytes(mtl.data(), mtl.size(), key.mtlHash);
+    }
+    return true;
+}
+
+bool MeshCache::write(const std::string& cachePath, const MeshCacheKey& key, uint32_t flags,
+                      const std::vector<MeshView>& meshes)
+{
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    VertexFormat format = meshes.empty() ? VertexFormat::Float32 : meshes[0].format;
+    const size_t stride = vertexStride(format);
+    header.version = kVersion;
+    header.vertexFormat = (uint32_t)format;
+    header.key = key;
+    header.meshCount = (uint32_t)meshes.size();
+    header.flags = flags;
+
+    // 配置各區塊位移：header | records | paths | (vertices, indices)*
+    std::vector<MeshRecord> records(meshes.size());
+    uint64_t offset = sizeof(FileHeader) + records.size() * sizeof(MeshRecord);
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        records[i].pathOffset = (uint32_t)offset;
+        records[i].pathLength = (uint32_t)meshes[i].texturePath.size();
+        offset += meshes[i].texturePath.size();
+    }
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        offset = alignUp(offset, 16);
+        records[i].vertexOffset = offset;
+        records[i].vertexCount = meshes[i].vertexCount;
+        offset += (uint64_t)meshes[i].vertexCount * stride;
+        for (int k = 0; k < 3; k++)
+        {
+            records[i].posOffset[k] = meshes[i].posOffset[k];
+            records[i].posScale[k] = meshes[i].posScale[k];
+            records[i].boundsCenter[k] = meshes[i].bounds.center[k];
+            records[i].boundsExtent[k] = meshes[i].bounds.extent[k];
+        }
+        records[i].boundsRadius = meshes[i].bounds.radius;
+        records[i].uvDensity = meshes[i].bounds.uvDensity;
+
+        offset = alignUp(offset, 16);
+        records[i].indexOffset = offset;
+        records[i].indexCount = meshes[i].indexCount;
+        offset += (uint64_t)meshes[i].indexCount * sizeof(unsigned);
+    }
+
+    // 先寫入暫存檔再改名，避免留下寫到一半的快取
+    std::string tmpPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        static const char zeros[16] = {};
+        uint64_t pos = 0;
+        auto put = [&](const void* p, size_t n) {
+            out.write(static_cast<const char*>(p), (std::streamsize)n);
+            pos += n;
+        };
+        auto pad = [&](uint64_t target) { put(zeros, (size_t)(target - pos)); };
+
+        put(&header, sizeof(header));
+        put(records.data(), records.size() * sizeof(MeshRecord));
+        for (const auto& m : meshes)
+            put(m.texturePath.data(), m.texturePath.size());
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            pad(records[i].vertexOffset);
+            put(meshes[i].vertices, (size_t)meshes[i].vertexCount * stride);
+            pad(records[i].indexOffset);
+            put(meshes[i].indices, (size_t)meshes[i].indexCount * sizeof(unsigned));
+        }
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, cachePath, ec);
+    if (ec)
+    {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::open(const std::string& cachePath, const MeshCacheKey& key, uint32_t flags)
+{
+    meshes_.clear();
+    if (!file_.open(cachePath) || file_.size() < sizeof(FileHeader))
+        return false;
+
+    FileHeader header;
+    std::memcpy(&header, file_.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion ||
+        header.vertexFormat > (uint32_t)VertexFormat::Packed8 ||
+        header.flags != flags ||
+        !(header.key == key))
+    {
+        file_.close();
+        return false;
+    }
+
+    const VertexFormat format = (VertexFormat)header.vertexFormat;
+    const uint64_t stride = vertexStride(format);
+    uint64_t size = file_.size();
+    uint64_t tableEnd = sizeof(FileHeader) + (uint64_t)header.meshCount * sizeof(MeshRecord);
+    if (tableEnd > size)
+    {
+        file_.close();
+        return false;
+    }
+
+    const char* base = file_.data();
+    meshes_.reserve(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++)
+    {
+        MeshRecord r;
+        std::memcpy(&r, base + sizeof(FileHeader) + i * sizeof(MeshRecord), sizeof(r));
+        if ((uint64_t)r.pathOffset + r.pathLength > size ||
+            r.vertexOffset + (uint64_t)r.vertexCount * stride > size ||
+            r.indexOffset + (uint64_t)r.indexCount * sizeof(unsigned) > size)
+        {
+            std::cerr << "Corrupt mesh cache: " << cachePath << std::endl;
+            meshes_.clear();
+            file_.close();
+            return false;
+        }
+
+        MeshView view;
+        view.format = format;
+        view.vertices = base + r.vertexOffset;
+        view.vertexCount = r.vertexCount;
+        view.posOffset = glm::vec3(r.posOffset[0], r.posOffset[1], r.posOffset[2]);
+        view.posScale = glm::vec3(r.posScale[0], r.posScale[1], r.posScale[2]);
+        view.bounds.center = glm::vec3(r.boundsCenter[0], r.boundsCenter[1], r.boundsCenter[2]);
+        view.bounds.extent = glm::vec3(r.boundsExtent[0], r.boundsExtent[1], r.boundsExtent[2]);
+        view.bounds.radius = r.boundsRadius;
+        view.bounds.uvDensity = r.uvDensity;
+        view.indices = reinterpret_cast<const unsigned*>(base + r.indexOffset);
+        view.indexCount = r.indexCount;
+        view.texturePath.assign(base + r.pathOffset, r.pathLength);
+        meshes_.push_back(std::move(view));
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "file_util.h"
+#include "mesh_data.h"
+
+// 快取鍵：OBJ 與其引用之 MTL 的大小、修改時間與內容雜湊
+struct MeshCacheKey {
+    uint64_t objSize = 0;
+    int64_t objMtime = 0;
+    uint64_t objHash = 0;
+    uint64_t mtlSize = 0;
+    int64_t mtlMtime = 0;
+    uint64_t mtlHash = 0;
+
+    bool operator==(const MeshCacheKey& o) const {
+        return objSize == o.objSize && objMtime == o.objMtime && objHash == o.objHash &&
+               mtlSize == o.mtlSize && mtlMtime == o.mtlMtime && mtlHash == o.mtlHash;
+    }
+};
+
+// 指向映射檔案內部的 mesh（可直接交給 glBufferData）
+struct MeshView {
+    VertexFormat format = VertexFormat::Float32;
+    const void* vertices = nullptr; // vertexStride(format) bytes / 頂點
+    uint32_t vertexCount = 0;
+    glm::vec3 posOffset{0.0f};
+    glm::vec3 posScale{1.0f};
+    const unsigned* indices = nullptr;
+    uint32_t indexCount = 0;
+    std::string texturePath;
+    MeshBounds bounds;
+};
+
+// 版本化的二進位 mesh 快取，存放於 OBJ 旁的 <obj>.meshcache
+class MeshCache {
+public:
+    static std::string pathFor(const std::string& objPath);
+    static bool computeKey(const std::string& objPath, MeshCacheKey& key);
+    // flags 記錄產生快取時的載入選項，選項不同即視為失效
+    static bool write(const std::string& cachePath, const MeshCacheKey& key, uint32_t flags,
+                      const std::vector<MeshView>& meshes);
+
+    // 映射快取檔；版本、鍵或 flags 不符時回傳 false
+    bool open(const std::string& cachePath, const MeshCacheKey& key, uint32_t flags);
+    const std::vector<MeshView>& meshes() const { return meshes_; }
+
+private:
+    MappedFile file_;
+    std::vector<MeshView> meshes_;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// 交錯頂點格式（位置 / 法線 / UV）
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 tex;
+};
+
+// GPU 頂點格式
+enum class VertexFormat : uint32_t {
+    Float32 = 0,  // Vertex，32 bytes
+    Packed16 = 1, // unorm16 位置 + 八面體 snorm16 法線 + half UV，16 bytes
+    Packed8 = 2,  // unorm16 位置 + 八面體 snorm8 法線 + half UV，12 bytes
+};
+
+// 物件空間的 AABB / 包圍球（共用中心）與 UV 密度，供視錐剔除與貼圖 mip 串流估計所需解析度
+struct MeshBounds {
+    glm::vec3 center{0.0f};
+    glm::vec3 extent{0.0f}; // AABB 半邊長
+    float radius = 0.0f;
+    float uvDensity = 0.0f; // sqrt(UV 面積 / 物件空間面積)，即每單位長度跨越的 UV；0 = 未知
+};
+
+// 上傳前的 CPU 端 mesh（一個材質區段）
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned> indices;
+    std::string texturePath; // 空字串 = 無貼圖
+    MeshBounds bounds;
+
+    // 量化後的頂點（format != Float32 時取代 vertices）
+    VertexFormat format = VertexFormat::Float32;
+    std::vector<uint8_t> packedVertices;
+    glm::vec3 posOffset{0.0f}; // 解碼：pos = posOffset + posScale * unorm
+    glm::vec3 posScale{1.0f};
+};
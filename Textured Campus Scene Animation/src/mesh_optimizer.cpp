@@ -0,0 +1,236 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation" 的建議參數
+const int kCacheSize = 32;
+const float kCacheDecayPower = 1.5f;
+const float kLastTriScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+const unsigned kMaxValence = 64;
+
+struct ScoreTable {
+    float cache[kCacheSize];
+    float valence[kMaxValence];
+
+    ScoreTable() {
+        for (int i = 0; i < kCacheSize; i++) {
+            if (i < 3) {
+                // 剛用過的三角形頂點給固定分數，避免連續使用同一邊
+                cache[i] = kLastTriScore;
+            } else {
+                const float scaler = 1.0f / (kCacheSize - 3);
+                cache[i] = std::pow(1.0f - (i - 3) * scaler, kCacheDecayPower);
+            }
+        }
+        valence[0] = 0.f;
+        for (unsigned i = 1; i < kMaxValence; i++)
+            valence[i] = kValenceBoostScale * std::pow((float)i, -kValenceBoostPower);
+    }
+};
+
+float vertexScore(int cachePos, unsigned liveTris) {
+    static const ScoreTable table;
+    if (liveTris == 0)
+        return -1.f; // 已無剩餘三角形
+
+    float score = cachePos >= 0 ? table.cache[cachePos] : 0.f;
+    score += liveTris < kMaxValence
+                 ? table.valence[liveTris]
+                 : kValenceBoostScale * std::pow((float)liveTris, -kValenceBoostPower);
+    return score;
+}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const unsigned* indices, size_t indexCount,
+                                    size_t vertexCount, unsigned cacheSize) {
+    VertexCacheStats stats;
+    stats.triangles = indexCount / 3;
+    stats.vertices = vertexCount;
+
+    // 以時間戳模擬 FIFO：距上次進入快取超過 cacheSize 次即視為已被擠出
+    std::vector<size_t> stamp(vertexCount, 0);
+    size_t timestamp = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned v = indices[i];
+        if (timestamp - stamp[v] > cacheSize) {
+            stamp[v] = timestamp++;
+            stats.transformed++;
+        }
+    }
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<unsigned>& indices, size_t vertexCount) {
+    const size_t triCount = indices.size() / 3;
+    if (triCount == 0)
+        return;
+
+    // 頂點 -> 相鄰三角形（CSR），live[v] 為尚未輸出的三角形數
+    std::vector<unsigned> live(vertexCount, 0);
+    for (size_t i = 0; i < triCount * 3; i++)
+        live[indices[i]]++;
+
+    std::vector<size_t> offset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offset[v + 1] = offset[v] + live[v];
+
+    std::vector<unsigned> adjacency(triCount * 3);
+    {
+        std::vector<size_t> fill(offset.begin(), offset.end() - 1);
+        for (size_t t = 0; t < triCount; t++)
+            for (int k = 0; k < 3; k++)
+                adjacency[fill[indices[3 * t + k]]++] = (unsigned)t;
+    }
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vScore[v] = vertexScore(-1, live[v]);
+
+    std::vector<char> emitted(triCount, 0);
+    auto triScore = [&](size_t t) {
+        return vScore[indices[3 * t]] + vScore[indices[3 * t + 1]] + vScore[indices[3 * t + 2]];
+    };
+
+    long best = 0;
+    float bestScore = -1.f;
+    for (size_t t = 0; t < triCount; t++) {
+        float s = triScore(t);
+        if (s > bestScore) {
+            bestScore = s;
+            best = (long)t;
+        }
+    }
+
+    std::vector<unsigned> out;
+    out.reserve(triCount * 3);
+
+    unsigned cache[kCacheSize + 3];
+    int cacheCount = 0;
+    size_t cursor = 0;
+
+    while (best >= 0) {
+        const unsigned tri[3] = {indices[3 * best], indices[3 * best + 1], indices[3 * best + 2]};
+        emitted[best] = 1;
+        out.insert(out.end(), tri, tri + 3);
+
+        // 從相鄰列表移除此三角形
+        for (int k = 0; k < 3; k++) {
+            unsigned v = tri[k];
+            unsigned* adj = &adjacency[offset[v]];
+            unsigned n = live[v];
+            for (unsigned i = 0; i < n; i++) {
+                if (adj[i] == (unsigned)best) {
+                    adj[i] = adj[n - 1];
+                    break;
+                }
+            }
+            live[v]--;
+        }
+
+        // 新快取：本三角形頂點在前，其餘依序後移
+        unsigned next[kCacheSize + 3];
+        int n = 0;
+        for (int k = 0; k < 3; k++) {
+            bool dup = false;
+            for (int i = 0; i < n; i++)
+                dup |= next[i] == tri[k];
+            if (!dup)
+                next[n++] = tri[k];
+        }
+        for (int i = 0; i < cacheCount; i++) {
+            unsigned v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                next[n++] = v;
+        }
+
+        for (int i = 0; i < n; i++) {
+            unsigned v = next[i];
+            cachePos[v] = i < kCacheSize ? i : -1;
+            vScore[v] = vertexScore(cachePos[v], live[v]);
+        }
+        cacheCount = n < kCacheSize ? n : kCacheSize;
+        for (int i = 0; i < cacheCount; i++)
+            cache[i] = next[i];
+
+        // 只需重新評分與快取內（及剛被擠出）頂點相鄰的三角形
+        best = -1;
+        bestScore = -1.f;
+        for (int i = 0; i < n; i++) {
+            unsigned v = next[i];
+            const unsigned* adj = &adjacency[offset[v]];
+            for (unsigned j = 0; j < live[v]; j++) {
+                float s = triScore(adj[j]);
+                if (s > bestScore) {
+                    bestScore = s;
+                    best = (long)adj[j];
+                }
+            }
+        }
+
+        // 快取內無可用三角形時，取下一個尚未輸出的三角形
+        if (best < 0) {
+            while (cursor < triCount && emitted[cursor])
+                cursor++;
+            if (cursor < triCount)
+                best = (long)cursor;
+        }
+    }
+
+    indices.swap(out);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned>& indices) {
+    const unsigned kUnused = ~0u;
+    std::vector<unsigned> remap(vertices.size(), kUnused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (auto& idx : indices) {
+        if (remap[idx] == kUnused) {
+            remap[idx] = (unsigned)reordered.size();
+            reordered.push_back(vertices[idx]);
+        }
+        idx = remap[idx];
+    }
+    vertices.swap(reordered);
+}
+
+MeshBounds computeMeshBounds(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices) {
+    MeshBounds bounds;
+    if (vertices.empty())
+        return bounds;
+
+    glm::vec3 lo = vertices[0].pos, hi = vertices[0].pos;
+    for (const auto& v : vertices) {
+        lo = glm::min(lo, v.pos);
+        hi = glm::max(hi, v.pos);
+    }
+    bounds.center = (lo + hi) * 0.5f;
+    bounds.extent = (hi - lo) * 0.5f;
+    float radius2 = 0.f;
+    for (const auto& v : vertices) {
+        glm::vec3 d = v.pos - bounds.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    bounds.radius = std::sqrt(radius2);
+
+    // 兩者皆為三角形面積的兩倍，比值不受影響
+    double area = 0.0, uvArea = 0.0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const Vertex& a = vertices[indices[i]];
+        const Vertex& b = vertices[indices[i + 1]];
+        const Vertex& c = vertices[indices[i + 2]];
+        area += glm::length(glm::cross(b.pos - a.pos, c.pos - a.pos));
+        glm::vec2 e1 = b.tex - a.tex, e2 = c.tex - a.tex;
+        uvArea += std::fabs(e1.x * e2.y - e1.y * e2.x);
+    }
+    if (area > 0.0 && uvArea > 0.0)
+        bounds.uvDensity = (float)std::sqrt(uvArea / area);
+    return bounds;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "mesh_data.h"
+
+// 以 FIFO 快取模擬 post-transform vertex cache
+struct VertexCacheStats {
+    size_t triangles = 0;
+    size_t vertices = 0;
+    size_t transformed = 0; // 快取未命中次數（= vertex shader 執行次數）
+
+    float acmr() const { return triangles ? (float)transformed / triangles : 0.f; } // 每三角形平均未命中
+    float atvr() const { return vertices ? (float)transformed / vertices : 0.f; }   // 相對理想值 1.0 的倍數
+
+    VertexCacheStats& operator+=(const VertexCacheStats& o) {
+        triangles += o.triangles;
+        vertices += o.vertices;
+        transformed += o.transformed;
+        return *this;
+    }
+};
+
+VertexCacheStats analyzeVertexCache(const unsigned* indices, size_t indexCount,
+                                    size_t vertexCount, unsigned cacheSize = 16);
+
+// Forsyth 線性演算法：重排三角形順序以提高頂點快取命中率
+void optimizeVertexCache(std::vector<unsigned>& indices, size_t vertexCount);
+
+// 依首次使用順序重排頂點，讓 vertex fetch 連續（未被引用的頂點會被移除）
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned>& indices);
+
+// AABB、包圍球（AABB 中心 + 最遠頂點距離）與三角形面積加權的 UV 密度；需在量化前呼叫
+MeshBounds computeMeshBounds(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices);
@@ -0,0 +1,528 @@
+#include "mip_chain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIP_SSE2 1
+#endif
+
+namespace {
+
+// ---- sRGB <-> 線性 ----
+struct SrgbTables {
+    float toLinear[256];
+    static const int kEncodeSize = 16384;
+    uint8_t toSrgb[kEncodeSize + 1];
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i <= kEncodeSize; i++)
+        {
+            float l = (float)i / kEncodeSize;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+            toSrgb[i] = (uint8_t)std::lround(std::min(std::max(c, 0.f), 1.f) * 255.f);
+        }
+    }
+};
+
+const SrgbTables& srgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+uint8_t encodeSrgb(float linear)
+{
+    float t = std::min(std::max(linear, 0.f), 1.f);
+    return srgbTables().toSrgb[(int)(t * SrgbTables::kEncodeSize + 0.5f)];
+}
+
+uint8_t encodeUnorm(float v)
+{
+    return (uint8_t)(std::min(std::max(v, 0.f), 1.f) * 255.f + 0.5f);
+}
+
+// 單一 channel 的浮點平面
+struct Plane {
+    int width = 0, height = 0;
+    std::vector<float> data;
+
+    float* row(int y) { return &data[(size_t)y * width]; }
+    const float* row(int y) const { return &data[(size_t)y * width]; }
+};
+
+// ---- Box：dst = (a[2x] + a[2x+1] + b[2x] + b[2x+1]) / 4 ----
+Plane downsampleBox(const Plane& src)
+{
+    Plane dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.data.resize((size_t)dst.width * dst.height);
+
+    for (int y = 0; y < dst.height; y++)
+    {
+        const float* a = src.row(std::min(2 * y, src.height - 1));
+        const float* b = src.row(std::min(2 * y + 1, src.height - 1));
+        float* out = dst.row(y);
+        int x = 0;
+#ifdef MIP_SSE2
+        // 一次輸出 4 個：讀入兩列各 8 個來源，先垂直相加再兩兩水平相加
+        if (src.width >= 2)
+        {
+            const __m128 quarter = _mm_set1_ps(0.25f);
+            for (; 2 * x + 7 < src.width && x + 3 < dst.width; x += 4)
+            {
+                __m128 s0 = _mm_add_ps(_mm_loadu_ps(a + 2 * x), _mm_loadu_ps(b + 2 * x));
+                __m128 s1 = _mm_add_ps(_mm_loadu_ps(a + 2 * x + 4), _mm_loadu_ps(b + 2 * x + 4));
+                __m128 even = _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 odd = _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(out + x, _mm_mul_ps(_mm_add_ps(even, odd), quarter));
+            }
+        }
+#endif
+        for (; x < dst.width; x++)
+        {
+            int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+            out[x] = (a[x0] + a[x1] + b[x0] + b[x1]) * 0.25f;
+        }
+    }
+    return dst;
+}
+
+// ---- Kaiser：8 tap 可分離濾波，先垂直（沿 x 向量化）再水平 ----
+const int kKaiserTaps = 8;
+
+float bessel0(float x)
+{
+    float sum = 1.f, term = 1.f;
+    for (int k = 1; k < 16; k++)
+    {
+        term *= (x / (2.f * k)) * (x / (2.f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+const float kPi = 3.14159265358979f;
+
+// Kaiser 窗（beta = 4）；r 為相對窗半徑的位置，|r| >= 1 時為 0
+float kaiserWindow(float r)
+{
+    const float beta = 4.f;
+    return bessel0(beta * std::sqrt(std::max(0.f, 1.f - r * r))) / bessel0(beta);
+}
+
+float sinc(float x)
+{
+    return x == 0.f ? 1.f : std::sin(kPi * x) / (kPi * x);
+}
+
+struct KaiserKernel {
+    float w[kKaiserTaps];
+
+    KaiserKernel()
+    {
+        const float radius = 4.f;
+        float total = 0.f;
+        for (int k = 0; k < kKaiserTaps; k++)
+        {
+            // 來源像素中心相對輸出中心的距離（以來源像素為單位）：-3.5 ... 3.5
+            float t = k - 3.5f;
+            w[k] = sinc(t * 0.5f) * kaiserWindow(t / radius); // 2 倍縮小：截止頻率為一半
+            total += w[k];
+        }
+        for (float& v : w)
+            v /= total;
+    }
+};
+
+const KaiserKernel& kaiserKernel()
+{
+    static const KaiserKernel kernel;
+    return kernel;
+}
+
+Plane downsampleKaiser(const Plane& src)
+{
+    const float* w = kaiserKernel().w;
+
+    // 垂直：tmp 為 dst.height x src.width
+    Plane tmp;
+    tmp.width = src.width;
+    tmp.height = std::max(1, src.height / 2);
+    tmp.data.assign((size_t)tmp.width * tmp.height, 0.f);
+    for (int y = 0; y < tmp.height; y++)
+    {
+        float* out = tmp.row(y);
+        for (int k = 0; k < kKaiserTaps; k++)
+        {
+            const float* in = src.row(std::min(std::max(2 * y - 3 + k, 0), src.height - 1));
+            int x = 0;
+#ifdef MIP_SSE2
+            const __m128 wk = _mm_set1_ps(w[k]);
+            for (; x + 3 < tmp.width; x += 4)
+                _mm_storeu_ps(out + x, _mm_add_ps(_mm_loadu_ps(out + x), _mm_mul_ps(wk, _mm_loadu_ps(in + x))));
+#endif
+            for (; x < tmp.width; x++)
+                out[x] += w[k] * in[x];
+        }
+    }
+
+    // 水平
+    Plane dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = tmp.height;
+    dst.data.resize((size_t)dst.width * dst.height);
+    for (int y = 0; y < dst.height; y++)
+    {
+        const float* in = tmp.row(y);
+        float* out = dst.row(y);
+        for (int x = 0; x < dst.width; x++)
+        {
+            float sum = 0.f;
+            int first = 2 * x - 3;
+            if (first >= 0 && first + kKaiserTaps <= tmp.width)
+            {
+                for (int k = 0; k < kKaiserTaps; k++)
+                    sum += w[k] * in[first + k];
+            }
+            else
+            {
+                for (int k = 0; k < kKaiserTaps; k++)
+                    sum += w[k] * in[std::min(std::max(first + k, 0), tmp.width - 1)];
+            }
+            out[x] = sum;
+        }
+    }
+    return dst;
+}
+
+// ---- 任意比例縮小：Kaiser 窗 sinc，半徑隨縮小比例放大（輸出像素 2 個單位） ----
+const float kResampleRadius = 2.f;
+
+// 每個輸出座標對應一段連續來源像素；權重數補零到 4 的倍數以便 SSE 內積
+struct ResampleTaps {
+    int taps = 0;
+    std::vector<int> first;     // 第一個來源索引（可能超出範圍，讀取時夾住）
+    std::vector<float> weights; // 輸出數 x taps
+};
+
+ResampleTaps resampleTaps(int srcSize, int dstSize)
+{
+    const float scale = (float)dstSize / srcSize;
+    const float support = kResampleRadius / std::min(scale, 1.f); // 以來源像素計
+    ResampleTaps t;
+    t.taps = ((int)std::ceil(2.f * support) + 1 + 3) & ~3;
+    t.first.resize(dstSize);
+    t.weights.assign((size_t)dstSize * t.taps, 0.f);
+    for (int i = 0; i < dstSize; i++)
+    {
+        const float center = (i + 0.5f) / scale - 0.5f;
+        const int first = (int)std::floor(center - support) + 1;
+        float* w = &t.weights[(size_t)i * t.taps];
+        float total = 0.f;
+        for (int k = 0; k < t.taps; k++)
+        {
+            const float d = (first + k - center) * std::min(scale, 1.f); // 以輸出像素計
+            if (std::fabs(d) >= kResampleRadius)
+                continue;
+            w[k] = sinc(d) * kaiserWindow(d / kResampleRadius);
+            total += w[k];
+        }
+        for (int k = 0; k < t.taps; k++)
+            w[k] /= total;
+        t.first[i] = first;
+    }
+    return t;
+}
+
+// out += w * in（沿 x 向量化）
+void accumulateRow(float* out, const float* in, float w, int width)
+{
+    int x = 0;
+#ifdef MIP_SSE2
+    const __m128 wk = _mm_set1_ps(w);
+    for (; x + 3 < width; x += 4)
+        _mm_storeu_ps(out + x, _mm_add_ps(_mm_loadu_ps(out + x), _mm_mul_ps(wk, _mm_loadu_ps(in + x))));
+#endif
+    for (; x < width; x++)
+        out[x] += w * in[x];
+}
+
+// 水平縮放一列：每個輸出以 4 個權重一組做內積
+void resampleRow(const ResampleTaps& xt, const float* in, int srcWidth, float* out, int dstWidth)
+{
+    for (int x = 0; x < dstWidth; x++)
+    {
+        const float* w = &xt.weights[(size_t)x * xt.taps];
+        const int first = xt.first[x];
+        float sum = 0.f;
+        if (first >= 0 && first + xt.taps <= srcWidth)
+        {
+            int k = 0;
+#ifdef MIP_SSE2
+            __m128 acc = _mm_setzero_ps();
+            for (; k < xt.taps; k += 4)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(w + k), _mm_loadu_ps(in + first + k)));
+            acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+            acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+            sum = _mm_cvtss_f32(acc);
+#endif
+            for (; k < xt.taps; k++)
+                sum += w[k] * in[first + k];
+        }
+        else
+        {
+            for (int k = 0; k < xt.taps; k++)
+                sum += w[k] * in[std::min(std::max(first + k, 0), srcWidth - 1)];
+        }
+        out[x] = sum;
+    }
+}
+
+// alpha 乘上 scale 後高於門檻的比例
+float coverage(const Plane& alpha, float scale, float cutoff)
+{
+    size_t covered = 0;
+    for (float a : alpha.data)
+        covered += a * scale > cutoff ? 1 : 0;
+    return alpha.data.empty() ? 0.f : (float)covered / alpha.data.size();
+}
+
+// 8 bit alpha 直方圖乘上 scale 後高於門檻的比例
+float coverage(const size_t (&histogram)[256], size_t count, float scale, float cutoff)
+{
+    size_t covered = 0;
+    for (int v = 0; v < 256; v++)
+        covered += v / 255.f * scale > cutoff ? histogram[v] : 0;
+    return count == 0 ? 0.f : (float)covered / count;
+}
+
+// 二分搜尋使覆蓋率與基底一致的 alpha 縮放（覆蓋率隨 scale 單調遞增）
+template <typename CoverageAt>
+float searchCoverageScale(float target, CoverageAt coverageAt)
+{
+    float lo = 0.f, hi = 4.f, best = 1.f, bestError = 2.f;
+    for (int i = 0; i < 16; i++)
+    {
+        float mid = 0.5f * (lo + hi);
+        float c = coverageAt(mid);
+        if (std::fabs(c - target) < bestError)
+        {
+            bestError = std::fabs(c - target);
+            best = mid;
+        }
+        if (c < target)
+            lo = mid;
+        else if (c > target)
+            hi = mid;
+        else
+            break;
+    }
+    return best;
+}
+
+float coverageScale(const Plane& alpha, float target, float cutoff)
+{
+    return searchCoverageScale(target, [&](float scale) { return coverage(alpha, scale, cutoff); });
+}
+
+// 影像的 alpha channel（沒有時為 -1）
+int alphaChannelOf(int channels, const MipOptions& options)
+{
+    if (channels == 2 || channels == 4)
+        return channels - 1;
+    return channels == 1 && options.singleChannelAlpha ? 0 : -1;
+}
+
+bool isColorChannel(int c, int channels, int alphaChannel, const MipOptions& options)
+{
+    return options.srgb && c != alphaChannel && channels >= 2;
+}
+
+// 交錯的 8 bit 影像轉為各 channel 的線性浮點平面
+std::vector<Plane> toPlanes(const uint8_t* pixels, int width, int height, int channels, int alphaChannel,
+                            const MipOptions& options)
+{
+    const float* toLinear = srgbTables().toLinear;
+    std::vector<Plane> planes(channels);
+    for (int c = 0; c < channels; c++)
+    {
+        Plane& p = planes[c];
+        p.width = width;
+        p.height = height;
+        p.data.resize((size_t)width * height);
+        const bool color = isColorChannel(c, channels, alphaChannel, options);
+        for (size_t i = 0; i < p.data.size(); i++)
+        {
+            uint8_t v = pixels[i * channels + c];
+            p.data[i] = color ? toLinear[v] : v / 255.f;
+        }
+    }
+    return planes;
+}
+
+// 平面寫回交錯的 8 bit 影像；alpha 乘上 alphaScale
+void fromPlanes(const std::vector<Plane>& planes, int alphaChannel, float alphaScale, const MipOptions& options,
+                uint8_t* pixels)
+{
+    const int channels = (int)planes.size();
+    const size_t count = (size_t)planes[0].width * planes[0].height;
+    for (int c = 0; c < channels; c++)
+    {
+        const float* src = planes[c].data.data();
+        uint8_t* dst = pixels + c;
+        if (isColorChannel(c, channels, alphaChannel, options))
+        {
+            for (size_t i = 0; i < count; i++)
+                dst[i * channels] = encodeSrgb(src[i]);
+        }
+        else
+        {
+            const float scale = c == alphaChannel ? alphaScale : 1.f;
+            for (size_t i = 0; i < count; i++)
+                dst[i * channels] = encodeUnorm(src[i] * scale);
+        }
+    }
+}
+
+} // namespace
+
+uint32_t MipOptions::key() const
+{
+    uint32_t cutoff = (uint32_t)std::lround(std::min(std::max(alphaCutoff, 0.f), 1.f) * 255.f);
+    return (uint32_t)filter | (srgb ? 1u << 4 : 0u) | (preserveCoverage ? 1u << 5 : 0u) |
+           (singleChannelAlpha ? 1u << 6 : 0u) | (cutoff << 8);
+}
+
+std::vector<MipLevel> buildMipChain(const uint8_t* pixels, int width, int height, int channels,
+                                    const MipOptions& options)
+{
+    std::vector<MipLevel> levels;
+    if (!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+        return levels;
+
+    const int alphaChannel = alphaChannelOf(channels, options);
+
+    MipLevel base;
+    base.width = width;
+    base.height = height;
+    base.data.assign(pixels, pixels + (size_t)width * height * channels);
+    levels.push_back(std::move(base));
+
+    std::vector<Plane> planes = toPlanes(pixels, width, height, channels, alphaChannel, options);
+
+    const bool keepCoverage = options.preserveCoverage && alphaChannel >= 0;
+    float baseCoverage = keepCoverage ? coverage(planes[alphaChannel], 1.f, options.alphaCutoff) : 0.f;
+
+    while (planes[0].width > 1 || planes[0].height > 1)
+    {
+        for (auto& p : planes)
+            p = options.filter == MipFilter::Kaiser ? downsampleKaiser(p) : downsampleBox(p);
+
+        // 全透明或全不透明時無需調整
+        float alphaScale = 1.f;
+        if (keepCoverage && baseCoverage > 0.f && baseCoverage < 1.f)
+            alphaScale = coverageScale(planes[alphaChannel], baseCoverage, options.alphaCutoff);
+
+        // 縮放只影響輸出，下一層仍由未縮放的 alpha 濾波
+        MipLevel level;
+        level.width = planes[0].width;
+        level.height = planes[0].height;
+        level.data.resize((size_t)level.width * level.height * channels);
+        fromPlanes(planes, alphaChannel, alphaScale, options, level.data.data());
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+bool resampleImage(const uint8_t* pixels, int width, int height, int channels, uint8_t* dst, int dstWidth,
+                   int dstHeight, const MipOptions& options)
+{
+    if (!pixels || !dst || width <= 0 || height <= 0 || dstWidth <= 0 || dstHeight <= 0 || channels < 1 ||
+        channels > 4)
+        return false;
+
+    const int alphaChannel = alphaChannelOf(channels, options);
+    const float* toLinear = srgbTables().toLinear;
+    const ResampleTaps xt = resampleTaps(width, dstWidth);
+    const ResampleTaps yt = resampleTaps(height, dstHeight);
+
+    // 先水平後垂直：來源列用到時才轉為線性浮點並水平縮放，環中只保留最近 taps 列
+    // （各輸出列的來源區段單調前進），垂直累加後直接寫入 dst；暫存只有數列，與原圖大小無關
+    std::vector<float> linear((size_t)width);
+    std::vector<float> ring((size_t)yt.taps * channels * dstWidth);
+    std::vector<int> ringRow(yt.taps, -1);
+    std::vector<float> sum((size_t)channels * dstWidth);
+    for (int y = 0; y < dstHeight; y++)
+    {
+        std::fill(sum.begin(), sum.end(), 0.f);
+        const float* w = &yt.weights[(size_t)y * yt.taps];
+        for (int k = 0; k < yt.taps; k++)
+        {
+            if (w[k] == 0.f)
+                continue;
+            const int r = std::min(std::max(yt.first[y] + k, 0), height - 1);
+            const int slot = r % yt.taps;
+            float* rows = &ring[(size_t)slot * channels * dstWidth];
+            if (ringRow[slot] != r)
+            {
+                const uint8_t* in = pixels + (size_t)r * width * channels;
+                for (int c = 0; c < channels; c++)
+                {
+                    const bool color = isColorChannel(c, channels, alphaChannel, options);
+                    for (int x = 0; x < width; x++)
+                    {
+                        uint8_t v = in[(size_t)x * channels + c];
+                        linear[x] = color ? toLinear[v] : v / 255.f;
+                    }
+                    resampleRow(xt, linear.data(), width, rows + (size_t)c * dstWidth, dstWidth);
+                }
+                ringRow[slot] = r;
+            }
+            for (int c = 0; c < channels; c++)
+                accumulateRow(&sum[(size_t)c * dstWidth], rows + (size_t)c * dstWidth, w[k], dstWidth);
+        }
+
+        uint8_t* out = dst + (size_t)y * dstWidth * channels;
+        for (int c = 0; c < channels; c++)
+        {
+            const float* src = &sum[(size_t)c * dstWidth];
+            const bool color = isColorChannel(c, channels, alphaChannel, options);
+            for (int x = 0; x < dstWidth; x++)
+                out[(size_t)x * channels + c] = color ? encodeSrgb(src[x]) : encodeUnorm(src[x]);
+        }
+    }
+
+    // 與 buildMipChain 相同：依原圖的 alpha 覆蓋率調整；輸出已寫入 dst，改以 8 bit 直方圖搜尋縮放後就地調整
+    if (options.preserveCoverage && alphaChannel >= 0)
+    {
+        size_t covered = 0;
+        const size_t count = (size_t)width * height;
+        for (size_t i = 0; i < count; i++)
+            covered += pixels[i * channels + alphaChannel] / 255.f > options.alphaCutoff ? 1 : 0;
+        const float baseCoverage = (float)covered / count;
+        if (baseCoverage > 0.f && baseCoverage < 1.f)
+        {
+            size_t histogram[256] = {};
+            const size_t dstCount = (size_t)dstWidth * dstHeight;
+            for (size_t i = 0; i < dstCount; i++)
+                histogram[dst[i * channels + alphaChannel]]++;
+            const float alphaScale = searchCoverageScale(baseCoverage, [&](float scale) {
+                return coverage(histogram, dstCount, scale, options.alphaCutoff);
+            });
+            uint8_t scaled[256];
+            for (int v = 0; v < 256; v++)
+                scaled[v] = encodeUnorm(v / 255.f * alphaScale);
+            for (size_t i = 0; i < dstCount; i++)
+                dst[i * channels + alphaChannel] = scaled[dst[i * channels + alphaChannel]];
+        }
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct MipLevel {
+    int width = 0, height = 0;
+    std::vector<uint8_t> data;
+};
+
+// mip 縮小濾波器
+enum class MipFilter : uint32_t {
+    Box = 0,    // 2x2 平均，最快
+    Kaiser = 1, // Kaiser 窗 sinc（8 tap，可分離），較銳利、較少疊影
+};
+
+struct MipOptions {
+    MipFilter filter = MipFilter::Box;
+    bool srgb = true;               // 色彩 channel 先轉到線性空間再濾波
+    bool preserveCoverage = true;   // 各層依 alphaCutoff 維持與基底相同的 alpha 覆蓋率
+    bool singleChannelAlpha = false; // 單 channel 影像視為 alpha（如 Opacity 遮罩）
+    float alphaCutoff = 0.5f;
+
+    // 寫入貼圖快取的選項識別碼
+    uint32_t key() const;
+};
+
+// 由基底影像產生完整 mip 鏈（level 0 為原圖拷貝，直到 1x1），每層保持 channels 數
+// 2 / 4 channel 影像的最後一個 channel 為 alpha，不做 gamma 轉換
+std::vector<MipLevel> buildMipChain(const uint8_t* pixels, int width, int height, int channels,
+                                    const MipOptions& options);
+
+// 以可分離的 Kaiser 窗 sinc 把影像縮放為 dstWidth x dstHeight（任意比例，供載入時縮小過大的貼圖）
+// 色彩 / alpha 的處理與 buildMipChain 相同（filter 不使用）；dst 需有 dstWidth * dstHeight * channels bytes
+bool resampleImage(const uint8_t* pixels, int width, int height, int channels, uint8_t* dst, int dstWidth,
+                   int dstHeight, const MipOptions& options);
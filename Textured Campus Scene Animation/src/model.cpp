@@ -1,142 +1,984 @@
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
 #include "model.h"
+#include "file_util.h"
+#include "gl_state.h"
+#include "load_profiler.h"
+#include "mesh_cache.h"
+#include "mesh_data.h"
+#include "mesh_optimizer.h"
+#include "obj_parser.h"
+#include "resource_manager.h"
+#include "upload_ring.h"
+#include "vertex_format.h"
 #include <OpenGL/gl3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <filesystem>
+#include <iostream>
 
 using namespace std;
 namespace fs = std::filesystem;
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 normal;
-    glm::vec2 tex;
+// 以 (position, normal, texcoord) 索引組合辨識重複頂點
+struct VertexKey {
+    int v, n, t;
+    bool operator==(const VertexKey& o) const { return v == o.v && n == o.n && t == o.t; }
 };
 
-Model::Model(const string& objPath) {
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& k) const {
+        uint64_t h = (uint64_t)(uint32_t)k.v * 0x9E3779B97F4A7C15ull;
+        h ^= ((uint64_t)(uint32_t)k.n + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+        h ^= ((uint64_t)(uint32_t)k.t + 0x165667B19E3779F9ull) * 0x27D4EB2F165667C5ull;
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+using VertexRemap = unordered_map<VertexKey, unsigned, VertexKeyHash>;
+
+// 頂點合併統計
+struct WeldStats {
+    size_t corners = 0;  // 面頂點數（合併前的頂點數）
+    size_t unique = 0;   // 合併後的頂點數
+};
+
+// 加入一個面頂點；相同 (v, vn, vt) 組合重用既有頂點
+static void appendCorner(MeshData& mesh, VertexRemap& remap, const tinyobj::index_t& idx,
+                         const vector<float>& positions, const vector<float>& normals,
+                         const vector<float>& texcoords) {
+    VertexKey key{idx.vertex_index, idx.normal_index, idx.texcoord_index};
+    auto found = remap.find(key);
+    if (found != remap.end()) {
+        mesh.indices.push_back(found->second);
+        return;
+    }
+
+    Vertex vert{};
+
+    vert.pos = glm::vec3(
+        positions[3 * idx.vertex_index + 0],
+        positions[3 * idx.vertex_index + 1],
+        positions[3 * idx.vertex_index + 2]
+    );
+
+    if (idx.normal_index >= 0 && 3 * (size_t)idx.normal_index + 2 < normals.size()) {
+        vert.normal = glm::vec3(
+            normals[3 * idx.normal_index + 0],
+            normals[3 * idx.normal_index + 1],
+            normals[3 * idx.normal_index + 2]
+        );
+    }
+
+    if (idx.texcoord_index >= 0 && 2 * (size_t)idx.texcoord_index + 1 < texcoords.size()) {
+        vert.tex = glm::vec2(
+            texcoords[2 * idx.texcoord_index + 0],
+            texcoords[2 * idx.texcoord_index + 1]
+        );
+    }
+
+    unsigned newIndex = (unsigned)mesh.vertices.size();
+    remap.emplace(key, newIndex);
+    mesh.vertices.push_back(vert);
+    mesh.indices.push_back(newIndex);
+}
+
+// 材質 -> 貼圖完整路徑
+static unordered_map<int, string> textureMap(const tinyobj::material_t* materials, size_t count,
+                                             const string& searchPath) {
+    unordered_map<int, string> matTex;
+    for (size_t i = 0; i < count; i++) {
+        const auto& mat = materials[i];
+        if (!mat.diffuse_texname.empty()) {
+            fs::path texPath = fs::path(searchPath) / mat.diffuse_texname;
+            matTex[(int)i] = texPath.string();
+        }
+    }
+    return matTex;
+}
+
+// 解析 OBJ，依材質切成 CPU 端 mesh（跨 shape 合併同材質），並合併重複頂點
+static vector<MeshData> parseObj(const string& objPath, WeldStats& stats) {
     tinyobj::ObjReaderConfig config;
     config.mtl_search_path = fs::path(objPath).parent_path().string();
-    tinyobj::ObjReader reader;
+    FastObjReader reader;
 
-    if (!reader.ParseFromFile(objPath, config)) {
-        throw runtime_error("Failed to load OBJ: " + objPath + " " + reader.Error());
+    {
+        ScopedPhase phase(LoadPhase::Parse, objPath);
+        if (!reader.ParseFromFile(objPath, config)) {
+            throw runtime_error("Failed to load OBJ: " + objPath + " " + reader.Error());
+        }
+        std::error_code ec;
+        phase.addBytes(fs::file_size(objPath, ec));
     }
+    ScopedPhase phase(LoadPhase::VertexBuild, objPath);
 
     const auto& attrib = reader.GetAttrib();
     const auto& shapes = reader.GetShapes();
     const auto& materials = reader.GetMaterials();
+    unordered_map<int, string> matTex = textureMap(materials.data(), materials.size(), config.mtl_search_path);
 
-    unordered_map<int, unsigned> matTex;
-    for (size_t i = 0; i < materials.size(); i++) {
-        const auto& mat = materials[i];
-        if (!mat.diffuse_texname.empty()) {
-            fs::path texPath = fs::path(config.mtl_search_path) / mat.diffuse_texname;
-            matTex[(int)i] = texCache_.getOrLoad2D(texPath.string());
-        }
-    }
+    vector<MeshData> result;
+    vector<VertexRemap> remaps;          // 與 result 對應
+    unordered_map<int, size_t> slotOf;   // 材質 -> result 索引
 
-    // 對每個 shape 產生 mesh
     for (const auto& shape : shapes) {
-        vector<Vertex> vertices;
-        vector<unsigned> indices;
-
         size_t indexOffset = 0;
         for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
             int fv = shape.mesh.num_face_vertices[f];
             int matID = shape.mesh.material_ids[f];
 
-            for (int v = 0; v < fv; v++) {
-                tinyobj::index_t idx = shape.mesh.indices[indexOffset + v];
-                Vertex vert{};
-
-                vert.pos = glm::vec3(
-                    attrib.vertices[3 * idx.vertex_index + 0],
-                    attrib.vertices[3 * idx.vertex_index + 1],
-                    attrib.vertices[3 * idx.vertex_index + 2]
-                );
-
-                if (idx.normal_index >= 0) {
-                    vert.normal = glm::vec3(
-                        attrib.normals[3 * idx.normal_index + 0],
-                        attrib.normals[3 * idx.normal_index + 1],
-                        attrib.normals[3 * idx.normal_index + 2]
-                    );
+            // 依材質找到（或建立）對應的 mesh；材質第一次出現的順序即繪製順序
+            auto slot = slotOf.find(matID);
+            if (slot == slotOf.end()) {
+                slot = slotOf.emplace(matID, result.size()).first;
+                result.emplace_back();
+                remaps.emplace_back();
+                auto it = matTex.find(matID);
+                result.back().texturePath = it != matTex.end() ? it->second : string();
+            }
+            MeshData& mesh = result[slot->second];
+            auto& remap = remaps[slot->second];
+
+            for (int v = 0; v < fv; v++)
+                appendCorner(mesh, remap, shape.mesh.indices[indexOffset + v],
+                             attrib.vertices, attrib.normals, attrib.texcoords);
+            indexOffset += fv;
+        }
+    }
+
+    for (const auto& mesh : result) {
+        stats.corners += mesh.indices.size();
+        stats.unique += mesh.vertices.size();
+        phase.addBytes(mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned));
+    }
+    return result;
+}
+
+// 串流解析：FastObjReader 逐批解析區塊，這裡只保留尚未送出的材質區段
+// 材質區段在切換材質或區塊結束時（已達 kStreamMinFlushVertices）、超過 kStreamMaxVertices 或檔案結束時送出
+static const size_t kStreamMinFlushVertices = 32768;
+static const size_t kStreamMaxVertices = 131072;
+
+// 回呼期間的計時，累加到 ms
+struct CallbackTimer {
+    double& ms;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ~CallbackTimer() { ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); }
+};
+
+struct ObjStream {
+    struct Run {
+        MeshData mesh;
+        VertexRemap remap;
+    };
+
+    string searchPath;
+    unordered_map<int, string> matTex;
+    map<int, Run> runs; // 材質 -> 尚未送出的區段
+    int material = -1;
+    function<void(MeshData&&)> sink;
+    WeldStats weld;
+    size_t flushed = 0;
+    // 解析器回呼內的時間：扣除 sink（最佳化 / 量化自行記錄階段）後記為 VertexBuild，其餘才是 Parse
+    double callbackMs = 0.0, sinkMs = 0.0;
+    uint64_t buildBytes = 0;
+
+    void flush(int matID) {
+        auto it = runs.find(matID);
+        if (it == runs.end())
+            return;
+        MeshData mesh = std::move(it->second.mesh);
+        runs.erase(it);
+        if (mesh.indices.empty())
+            return;
+
+        auto tex = matTex.find(matID);
+        mesh.texturePath = tex != matTex.end() ? tex->second : string();
+        weld.corners += mesh.indices.size();
+        weld.unique += mesh.vertices.size();
+        buildBytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned);
+        flushed++;
+        CallbackTimer timer{sinkMs};
+        sink(std::move(mesh));
+    }
+
+    // 已過大的區段（flush 不影響未送出的其他材質）
+    void flushLarge(size_t minVertices) {
+        vector<int> ready;
+        for (const auto& run : runs)
+            if (run.second.mesh.vertices.size() >= minVertices)
+                ready.push_back(run.first);
+        for (int matID : ready)
+            flush(matID);
+    }
+
+    // 三角化後的面，索引已換算成 0-based
+    void triangles(const tinyobj::index_t* corners, size_t count, const tinyobj::attrib_t& attrib) {
+        CallbackTimer timer{callbackMs};
+        for (size_t k = 0; k < count; k += 3) {
+            Run& run = runs[material];
+            for (size_t c = k; c < k + 3; c++)
+                appendCorner(run.mesh, run.remap, corners[c], attrib.vertices, attrib.normals, attrib.texcoords);
+            if (run.mesh.vertices.size() >= kStreamMaxVertices)
+                flush(material);
+        }
+    }
+
+    void useMaterial(int id) {
+        if (id == material)
+            return;
+        CallbackTimer timer{callbackMs};
+        auto it = runs.find(material);
+        if (it != runs.end() && it->second.mesh.vertices.size() >= kStreamMinFlushVertices)
+            flush(material);
+        material = id;
+    }
+
+    void chunkDone() {
+        CallbackTimer timer{callbackMs};
+        flushLarge(kStreamMinFlushVertices);
+    }
+};
+
+static void streamObj(const string& objPath, const function<void(MeshData&&)>& sink, WeldStats& weld) {
+    ScopedPhase phase(LoadPhase::Parse, objPath);
+
+    ObjStream stream;
+    stream.searchPath = fs::path(objPath).parent_path().string();
+    stream.sink = sink;
+
+    FastObjCallbacks cb;
+    cb.materials = [&](const vector<tinyobj::material_t>& materials) {
+        stream.matTex = textureMap(materials.data(), materials.size(), stream.searchPath);
+    };
+    cb.useMaterial = [&](int id) { stream.useMaterial(id); };
+    cb.triangles = [&](const tinyobj::index_t* corners, size_t count, const tinyobj::attrib_t& attrib) {
+        stream.triangles(corners, count, attrib);
+    };
+    cb.chunkDone = [&]() { stream.chunkDone(); };
+
+    tinyobj::ObjReaderConfig config;
+    config.mtl_search_path = stream.searchPath;
+    FastObjReader reader;
+    if (!reader.StreamFromFile(objPath, cb, config))
+        throw runtime_error("Failed to load OBJ: " + objPath + " " + reader.Error());
+
+    {
+        CallbackTimer timer{stream.callbackMs};
+        while (!stream.runs.empty())
+            stream.flush(stream.runs.begin()->first);
+    }
+
+    std::error_code ec;
+    phase.addBytes(fs::file_size(objPath, ec));
+    phase.exclude(stream.callbackMs);
+    LoadProfiler::instance().record(LoadPhase::VertexBuild, objPath, stream.callbackMs - stream.sinkMs,
+                                    stream.buildBytes);
+    weld = stream.weld;
+    const auto& attrib = reader.GetAttrib();
+    std::cout << "Streamed OBJ: " << stream.flushed << " runs, attributes "
+              << (attrib.vertices.size() + attrib.normals.size() + attrib.texcoords.size()) * sizeof(float) / 1024
+              << " KB" << std::endl;
+}
+
+// 快取 flags：載入選項會改變快取內容者
+enum : uint32_t {
+    kCacheFlagVertexCacheOptimized = 1u << 0,
+    kCacheFlagVertexFormatShift = 1, // bit 1-2：VertexFormat
+};
+
+// 頂點重排與量化的累計統計
+struct BuildStats {
+    VertexCacheStats before, after;
+    QuantizationError error;
+    size_t floatBytes = 0, packedBytes = 0;
+
+    void print(const ModelLoadOptions& options) const {
+        if (options.optimizeVertexCache)
+            std::cout << "Vertex cache: ACMR " << before.acmr() << " -> " << after.acmr()
+                      << ", ATVR " << before.atvr() << " -> " << after.atvr() << std::endl;
+        if (options.vertexFormat != VertexFormat::Float32)
+            std::cout << "Quantized vertices: " << floatBytes / 1024 << " KB -> " << packedBytes / 1024
+                      << " KB, max error pos " << error.position << ", normal "
+                      << error.normalDegrees << " deg, uv " << error.texcoord << std::endl;
+    }
+};
+
+// 單一 mesh 的 vertex cache 最佳化與量化
+static void finalizeMesh(MeshData& data, const ModelLoadOptions& options, const string& objPath,
+                         BuildStats& stats) {
+    data.bounds = computeMeshBounds(data.vertices, data.indices);
+    if (options.optimizeVertexCache) {
+        ScopedPhase phase(LoadPhase::VertexOptimize, objPath);
+        phase.addBytes(data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(unsigned));
+        stats.before += analyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+        optimizeVertexCache(data.indices, data.vertices.size());
+        optimizeVertexFetch(data.vertices, data.indices);
+        stats.after += analyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+    }
+
+    if (options.vertexFormat != VertexFormat::Float32) {
+        ScopedPhase phase(LoadPhase::VertexQuantize, objPath);
+        size_t bytes = data.vertices.size() * sizeof(Vertex);
+        phase.addBytes(bytes);
+        stats.floatBytes += bytes;
+        stats.error.merge(quantizeMesh(data, options.vertexFormat));
+        stats.packedBytes += data.packedVertices.size();
+    }
+}
+
+static MeshView viewOf(const MeshData& data) {
+    MeshView view;
+    view.format = data.format;
+    view.vertices = vertexBytes(data);
+    view.vertexCount = (uint32_t)vertexCount(data);
+    view.posOffset = data.posOffset;
+    view.posScale = data.posScale;
+    view.indices = data.indices.data();
+    view.indexCount = (uint32_t)data.indices.size();
+    view.texturePath = data.texturePath;
+    view.bounds = data.bounds;
+    return view;
+}
+
+// 待上傳的 mesh
+struct PendingMesh {
+    MeshView view;
+    int textureSlot = -1;
+};
+
+// 背景載入的共享狀態：worker 產生 payload，GL thread 依預算上傳
+struct ModelLoadState {
+    std::mutex mutex;
+    std::thread worker;
+    std::atomic<bool> cancel{false};
+    std::chrono::steady_clock::time_point start;
+
+    // 只由 worker 存取；pending 內的 view 指向這些資料，載入結束前不釋放
+    MeshCache cache;                // 快取命中時的映射
+    std::deque<MeshData> owned;     // 解析產生的 mesh（deque 保持元素位址）
+    vector<MeshView> published;     // 已送出的 mesh（寫快取用）
+    unordered_map<string, int> slotOf; // 內容相同的路徑對應到同一個 slot
+    vector<string> texturePaths;    // slot -> 路徑（每種內容一個）
+    TextureDeduplicator dedup;
+    // slot -> 共用該 slot 的其他路徑；解碼開始前寫完，之後 GL thread 只讀
+    unordered_map<int, vector<string>> aliasesOf;
+    std::shared_ptr<TextureCache> textureCache; // 只呼叫 contains()，略過其他 Model 已上傳的貼圖
+
+    // 以下受 mutex 保護
+    std::deque<PendingMesh> pending;
+    size_t reserveVertices = 0, reserveIndices = 0; // 已知總量時預先配置 arena
+    std::deque<std::pair<int, DecodedImage>> textures; // 已解碼、待上傳
+    std::deque<std::pair<int, string>> sharedSlots; // 已在 TextureCache 中的 slot 與其路徑，GL thread 直接取得參考
+    vector<TextureArrays::Group> arrayGroups; // 貼圖陣列分組，GL thread 取走後清空
+    vector<TextureLayer> arrayLayers;         // slot -> 陣列位置
+    bool done = false;
+    std::exception_ptr error;
+
+    // 只由 GL thread 存取
+    size_t texturesUploaded = 0;
+    size_t texturesShared = 0;
+
+    // 送出一個 mesh 給 GL thread（worker 呼叫）
+    void publish(const MeshView& view) {
+        int slot = -1;
+        if (!view.texturePath.empty()) {
+            auto known = slotOf.find(view.texturePath);
+            if (known != slotOf.end()) {
+                slot = known->second;
+            } else {
+                const string& original = dedup.canonical(view.texturePath);
+                auto it = slotOf.emplace(original, (int)texturePaths.size());
+                if (it.second)
+                    texturePaths.push_back(original);
+                slot = it.first->second;
+                if (original != view.texturePath) {
+                    slotOf.emplace(view.texturePath, slot);
+                    aliasesOf[slot].push_back(view.texturePath);
                 }
+            }
+        }
+        published.push_back(view);
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back({view, slot});
+    }
+
+    void reserve(size_t vertices, size_t indices) {
+        std::lock_guard<std::mutex> lock(mutex);
+        reserveVertices = vertices;
+        reserveIndices = indices;
+    }
+};
+
+// 初次載入與降級後重新載入共用的貼圖解碼選項
+static TextureDecodeOptions textureOptions(const ModelLoadOptions& options) {
+    TextureDecodeOptions decode;
+    decode.compress = options.compressTextures;
+    decode.mip.filter = options.mipFilter;
+    decode.sizes = options.textureSizes;
+    return decode;
+}
+
+// CPU 端載入：快取 / 解析 / 最佳化 / 量化，接著逐張解碼貼圖（不碰 GL）
+static void loadCpu(const string& objPath, const ModelLoadOptions& options, ModelLoadState& state) {
+    try {
+        uint32_t cacheFlags = (uint32_t)options.vertexFormat << kCacheFlagVertexFormatShift;
+        if (options.optimizeVertexCache)
+            cacheFlags |= kCacheFlagVertexCacheOptimized;
 
-                if (idx.texcoord_index >= 0) {
-                    vert.tex = glm::vec2(
-                        attrib.texcoords[2 * idx.texcoord_index + 0],
-                        attrib.texcoords[2 * idx.texcoord_index + 1]
-                    );
+        // 先嘗試二進位快取：命中時直接從 mmap 區域上傳，不經過 OBJ 解析
+        MeshCacheKey key;
+        bool haveKey = MeshCache::computeKey(objPath, key);
+        string cachePath = MeshCache::pathFor(objPath);
+        bool cacheHit = false;
+        if (haveKey) {
+            ScopedPhase phase(LoadPhase::MeshCacheRead, objPath);
+            cacheHit = state.cache.open(cachePath, key, cacheFlags);
+            for (const auto& view : state.cache.meshes())
+                phase.addBytes((uint64_t)view.vertexCount * vertexStride(view.format) +
+                               (uint64_t)view.indexCount * sizeof(unsigned));
+        }
+
+        if (cacheHit) {
+            size_t vertices = 0, indices = 0;
+            for (const auto& view : state.cache.meshes()) {
+                vertices += view.vertexCount;
+                indices += view.indexCount;
+            }
+            state.reserve(vertices, indices);
+            for (const auto& view : state.cache.meshes())
+                state.publish(view);
+            std::cout << "Loaded mesh cache: " << cachePath << std::endl;
+        } else {
+            WeldStats weld;
+            BuildStats build;
+            if (options.streamObj) {
+                // 每個送出的材質區段立即最佳化、量化並交給 GL thread
+                streamObj(objPath, [&](MeshData&& mesh) {
+                    finalizeMesh(mesh, options, objPath, build);
+                    state.owned.push_back(std::move(mesh));
+                    state.publish(viewOf(state.owned.back()));
+                }, weld);
+            } else {
+                vector<MeshData> meshData = parseObj(objPath, weld);
+                size_t vertices = 0, indices = 0;
+                for (auto& data : meshData) {
+                    finalizeMesh(data, options, objPath, build);
+                    vertices += vertexCount(data);
+                    indices += data.indices.size();
+                }
+                state.reserve(vertices, indices);
+                for (auto& data : meshData) {
+                    state.owned.push_back(std::move(data));
+                    state.publish(viewOf(state.owned.back()));
                 }
+            }
 
-                vertices.push_back(vert);
-                indices.push_back((unsigned)indices.size());
+            if (weld.unique > 0) {
+                double savedMB = (double)(weld.corners - weld.unique) * sizeof(Vertex) / (1024.0 * 1024.0);
+                std::cout << "Welded vertices: " << weld.corners << " -> " << weld.unique
+                          << " (x" << (double)weld.corners / weld.unique << "), upload saved "
+                          << savedMB << " MB" << std::endl;
             }
-            indexOffset += fv;
+            build.print(options);
+
+            // GL thread 此時只會讀取 mesh 資料，寫快取可同時進行
+            if (haveKey) {
+                ScopedPhase phase(LoadPhase::MeshCacheWrite, objPath);
+                if (MeshCache::write(cachePath, key, cacheFlags, state.published)) {
+                    std::error_code ec;
+                    phase.addBytes(fs::file_size(cachePath, ec));
+                } else {
+                    std::cerr << "Failed to write mesh cache: " << cachePath << std::endl;
+                }
+            }
+        }
 
-            // 當下一個面材質不同或結束時，建立一個新 Mesh
-            bool boundary = (f + 1 == shape.mesh.num_face_vertices.size()) ||
-                            (shape.mesh.material_ids[f + 1] != matID);
-            if (boundary && !indices.empty()) {
-                Mesh mesh;
-                glGenVertexArrays(1, &mesh.vao);
-                glBindVertexArray(mesh.vao);
-
-                glGenBuffers(1, &mesh.vbo);
-                glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-                glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-                glGenBuffers(1, &mesh.ebo);
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned), indices.data(), GL_STATIC_DRAW);
-
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-                glEnableVertexAttribArray(1);
-                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(sizeof(glm::vec3)));
-                glEnableVertexAttribArray(2);
-                glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2 * sizeof(glm::vec3)));
-
-                mesh.indexCount = (unsigned)indices.size();
-                mesh.textureID = matTex.count(matID) ? matTex[matID] : 0;
-                meshes_.push_back(mesh);
-
-                vertices.clear();
-                indices.clear();
+        if (state.dedup.duplicates() > 0) {
+            std::cout << "Texture dedup: " << state.dedup.duplicates() << " duplicate paths ("
+                      << state.dedup.duplicateFileBytes() / 1024 << " KB of files), decoding "
+                      << state.texturePaths.size() << " unique textures" << std::endl;
+        }
+
+        // 其他 Model 已上傳（以任一同內容路徑）的貼圖不再解碼，也不放入陣列（以空路徑讓 plan 略過）
+        vector<string> decodePaths, planPaths = state.texturePaths;
+        for (size_t slot = 0; slot < state.texturePaths.size(); slot++) {
+            const string* resident = nullptr;
+            if (state.textureCache->contains(state.texturePaths[slot])) {
+                resident = &state.texturePaths[slot];
+            } else if (auto aliases = state.aliasesOf.find((int)slot); aliases != state.aliasesOf.end()) {
+                for (const auto& path : aliases->second) {
+                    if (state.textureCache->contains(path)) {
+                        resident = &path;
+                        break;
+                    }
+                }
             }
+            if (resident) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.sharedSlots.emplace_back((int)slot, *resident);
+                planPaths[slot].clear();
+            } else {
+                decodePaths.push_back(state.texturePaths[slot]);
+            }
+        }
+
+        // 解碼前只讀標頭分組，GL thread 收到第一張貼圖時配置陣列
+        if (options.textureArrays) {
+            vector<TextureArrays::Group> groups;
+            vector<TextureLayer> layers = TextureArrays::plan(planPaths, groups, options.textureSizes);
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.arrayGroups = std::move(groups);
+            state.arrayLayers = std::move(layers);
         }
+
+        // 平行解碼，依完成順序排入佇列
+        const TextureDecodeOptions decodeOptions = textureOptions(options);
+        TextureCache::decodeParallel(decodePaths, [&](DecodedImage&& image) {
+            int slot = state.slotOf.at(image.path); // slotOf 此時已不再修改
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.textures.emplace_back(slot, std::move(image));
+        }, decodeOptions, options.textureThreads, &state.cancel);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.error = std::current_exception();
     }
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.done = true;
+}
+
+// 共用幾何的識別：同一 OBJ 且影響 GPU 資料的選項相同（貼圖解碼選項以先載入者為準）
+static string geometryKey(const string& objPath, const ModelLoadOptions& options) {
+    std::error_code ec;
+    fs::path path = fs::absolute(objPath, ec);
+    return (ec ? fs::path(objPath) : path.lexically_normal()).string() + "|" +
+           std::to_string((uint32_t)options.vertexFormat) + (options.optimizeVertexCache ? "o" : "") +
+           (options.textureArrays ? "a" : "");
 }
 
-Model::~Model() {
-    for (auto& m : meshes_) {
-        if (m.ebo) glDeleteBuffers(1, &m.ebo);
-        if (m.vbo) glDeleteBuffers(1, &m.vbo);
-        if (m.vao) glDeleteVertexArrays(1, &m.vao);
+Model::Model(const string& objPath, const ModelLoadOptions& requested) : objPath_(objPath) {
+    ResourceManager& resources = ResourceManager::instance();
+    texCache_ = resources.textureCache();
+    placeholder_ = resources.placeholderTexture();
+
+    // 陣列貼圖以完整解析度常駐，不參與 mip 串流與 VRAM 預算；兩者任一開啟（本 Model 或共用快取）時不打包，
+    // 讓所有貼圖都受其管理
+    ModelLoadOptions options = requested;
+    const bool managed = options.streamTextureMips || options.textureBudgetBytes > 0 || texCache_->streaming() ||
+                         texCache_->stats().budgetBytes > 0;
+    if (options.textureArrays && managed) {
+        std::cout << "Texture arrays disabled: mip streaming / VRAM budget active" << std::endl;
+        options.textureArrays = false;
+    }
+
+    // 相同模型已由其他 Model 載入（或正在載入）時直接共用；載入中則一起推進，同步載入時等到完成
+    geometryKey_ = geometryKey(objPath, options);
+    geometry_ = resources.geometry(geometryKey_);
+    if (geometry_) {
+        std::cout << "Shared model: " << objPath << " (" << geometry_.use_count() - 1 << " other users"
+                  << (geometry_->load ? ", still loading" : "") << ")" << std::endl;
+        if (!options.async) {
+            while (!update(std::numeric_limits<size_t>::max()))
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return;
+    }
+    geometry_ = std::make_shared<ModelGeometry>();
+    geometry_->vertexFormat = options.vertexFormat;
+    geometry_->textures = texCache_;
+    resources.addGeometry(geometryKey_, geometry_);
+
+    // 需查詢 GL extension，只能在 GL thread 決定
+    if (options.compressTextures && !TextureCache::compressionSupported()) {
+        std::cerr << "S3TC not supported, uploading textures uncompressed" << std::endl;
+        options.compressTextures = false;
+    }
+    geometry_->decodeOptions = std::make_shared<TextureDecodeOptions>(textureOptions(options));
+
+    // 快取層級的設定由所有 Model 共用：預算取最後設定的非零值，串流與 PBO 環只要有 Model 要求就開啟
+    if (options.textureBudgetBytes > 0)
+        texCache_->setBudget(options.textureBudgetBytes);
+    if (options.streamTextureMips)
+        texCache_->setStreaming(true);
+    if (options.uploadRingBytes > 0 && !texCache_->uploadRing())
+        texCache_->setUploadRing(std::make_shared<UploadRing>(options.uploadRingBytes));
+
+    ModelLoadState* state = new ModelLoadState;
+    geometry_->load.reset(state);
+    state->start = std::chrono::steady_clock::now();
+    state->textureCache = texCache_;
+    if (options.async) {
+        state->worker = std::thread([objPath, options, state]() { loadCpu(objPath, options, *state); });
+        return;
     }
+
+    loadCpu(objPath, options, *state);
+    update(std::numeric_limits<size_t>::max());
 }
 
-void Model::Draw() const {
-    static unsigned defaultTex = 0;
+bool Model::update(size_t budgetBytes) {
+    ModelGeometry& geo = *geometry_;
+    if (!geo.load)
+        return true;
+    ModelLoadState& state = *geo.load;
+    UploadRing* ring = texCache_->uploadRing();
+
+    // worker 的例外在 GL thread 重新拋出
+    auto checkError = [&]() {
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            error = state.error;
+        }
+        if (error) {
+            if (state.worker.joinable())
+                state.worker.join();
+            geo.load.reset();
+            std::rethrow_exception(error);
+        }
+    };
+    checkError();
+
+    // 每類資料每幀至少上傳一筆，避免單筆超過預算時停滯
+    size_t spent = 0;
+    while (spent == 0 || spent < budgetBytes) {
+        PendingMesh item;
+        size_t reserveVertices, reserveIndices;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.pending.empty())
+                break;
+            item = state.pending.front();
+            state.pending.pop_front();
+            reserveVertices = state.reserveVertices;
+            reserveIndices = state.reserveIndices;
+        }
+        reserveArena(std::max(geo.usedVertices + item.view.vertexCount, reserveVertices),
+                     std::max(geo.usedIndices + item.view.indexCount, reserveIndices));
+        spent += uploadMesh(item.view, item.textureSlot);
+    }
+
+    // PBO 環中 GPU 尚未讀完的區段不能覆寫：空間不足時把剩下的貼圖留到下一幀，而不是同步上傳；
+    // 預算無上限（同步載入）時不延後，交給 UploadRing::stage 退回直接上傳
+    const bool unlimited = budgetBytes == std::numeric_limits<size_t>::max();
+    UploadRing* deferRing = unlimited ? nullptr : ring;
+    size_t textureBytes = 0;
+    while (textureBytes == 0 || spent + textureBytes < budgetBytes) {
+        const size_t idle = deferRing && textureBytes > 0 ? deferRing->idleBytes() : 0;
+        std::pair<int, DecodedImage> item;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.textures.empty())
+                break;
+            const size_t next = state.textures.front().second.bytes();
+            if (textureBytes > 0 && deferRing && next <= deferRing->capacity() && next > idle)
+                break;
+            item = std::move(state.textures.front());
+            state.textures.pop_front();
+            if (!state.arrayGroups.empty()) {
+                geo.arrays.setGroups(std::move(state.arrayGroups));
+                geo.arrayPlan = std::move(state.arrayLayers);
+                state.arrayGroups.clear();
+            }
+        }
+        if ((size_t)item.first >= geo.textureHandles.size()) {
+            geo.textureHandles.resize(item.first + 1, -1);
+            geo.textureLayers.resize(item.first + 1);
+        }
+
+        // 有預定陣列位置時放入陣列；格式不符（如 BC1 / BC3 混用）時退回獨立貼圖
+        const TextureLayer where = (size_t)item.first < geo.arrayPlan.size() ? geo.arrayPlan[item.first] : TextureLayer();
+        if (where.group >= 0 && geo.arrays.upload(where, item.second, ring)) {
+            geo.textureLayers[item.first] = where;
+        } else {
+            setTexture(item.first, texCache_->upload(item.second, geo.decodeOptions));
+        }
+        textureBytes += item.second.bytes();
+        state.texturesUploaded++;
+    }
+
+    // 其他 Model 已上傳的貼圖只增加參考；期間已被釋放時改在此同步解碼
+    for (;;) {
+        std::pair<int, string> item;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.sharedSlots.empty())
+                break;
+            item = std::move(state.sharedSlots.front());
+            state.sharedSlots.pop_front();
+        }
+        int handle = texCache_->acquire(item.second);
+        if (handle < 0) {
+            const string& path = state.texturePaths[item.first];
+            handle = texCache_->upload(TextureCache::decode(path, *geo.decodeOptions), geo.decodeOptions);
+        }
+        setTexture(item.first, handle);
+        state.texturesShared++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.done || !state.pending.empty() || !state.textures.empty() || !state.sharedSlots.empty())
+            return false;
+    }
+    checkError();
 
-    // 若沒有建立 default texture，建一張灰階 1x1
-    if (defaultTex == 0) {
-        unsigned char gray[3] = {128, 128, 128};
-        glGenTextures(1, &defaultTex);
-        glBindTexture(GL_TEXTURE_2D, defaultTex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, gray);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (state.worker.joinable())
+        state.worker.join();
+    const size_t stride = vertexStride(geo.vertexFormat);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - state.start).count();
+    std::cout << "Mesh arena: " << geo.meshes.size() << " meshes, " << geo.usedVertices * stride / 1024
+              << " KB vertices, " << geo.usedIndices * sizeof(unsigned) / 1024 << " KB indices" << std::endl;
+    std::cout << "Model loaded: " << geo.meshes.size() << " meshes, " << state.texturesUploaded
+              << " textures (" << state.texturesShared << " shared) in " << ms << " ms, peak RSS "
+              << peakResidentBytes() / (1024 * 1024) << " MB" << std::endl;
+    const TextureStats& tex = texCache_->stats();
+    if (tex.textures > 0) {
+        const double resident = (double)std::max<uint64_t>(tex.residentBytes, 1);
+        std::cout << "Texture memory: " << tex.residentBytes / (1024 * 1024) << " MB (raw "
+                  << tex.rawBytes / (1024 * 1024) << " MB, x" << tex.rawBytes / resident << "), "
+                  << tex.compressed << "/" << tex.textures << " compressed, cache hits "
+                  << tex.cacheHits << "/" << tex.textures;
+        if (tex.aliases > 0)
+            std::cout << ", " << tex.aliases << " aliased (" << tex.aliasedBytes / 1024 << " KB saved)";
+        if (tex.budgetBytes > 0)
+            std::cout << ", budget " << tex.budgetBytes / (1024 * 1024) << " MB, " << tex.evicted << " evicted";
+        std::cout << std::endl;
     }
+    if (geo.arrays.layerCount() > 0) {
+        std::cout << "Texture arrays: " << geo.arrays.layerCount() << " textures in " << geo.arrays.arrayCount()
+                  << " arrays (" << geo.arrays.residentBytes() / (1024 * 1024) << " MB)" << std::endl;
+    }
+    if (ring) {
+        std::cout << "Upload ring: " << ring->stagedBytes() / (1024 * 1024) << " MB through "
+                  << ring->capacity() / (1024 * 1024) << " MB PBO, " << ring->fallbacks()
+                  << " direct uploads" << std::endl;
+    }
+    geo.load.reset();
+    return true;
+}
+
+// slot 改用 handle（已持有一個參考），內容相同的其他路徑也指向它
+void Model::setTexture(int slot, int handle) {
+    ModelGeometry& geo = *geometry_;
+    if ((size_t)slot >= geo.textureHandles.size()) {
+        geo.textureHandles.resize(slot + 1, -1);
+        geo.textureLayers.resize(slot + 1);
+    }
+    geo.textureHandles[slot] = handle;
+    auto aliases = geo.load->aliasesOf.find(slot);
+    if (aliases != geo.load->aliasesOf.end()) {
+        for (const auto& path : aliases->second)
+            texCache_->alias(path, handle);
+    }
+}
+
+// 確保 arena 容量；不足時配置較大的緩衝（至少加倍）並以 GPU 端複製既有內容
+void Model::reserveArena(size_t vertices, size_t indices) {
+    ModelGeometry& geo = *geometry_;
+    const size_t stride = vertexStride(geo.vertexFormat);
+    auto grow = [](GlBuffer& buffer, size_t usedBytes, size_t newBytes) {
+        unsigned next;
+        glGenBuffers(1, &next);
+        GlState::instance().bindBuffer(GL_COPY_WRITE_BUFFER, next);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+        if (buffer) {
+            GlState::instance().bindBuffer(GL_COPY_READ_BUFFER, buffer.get());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+        }
+        buffer.reset(next);
+    };
+
+    bool changed = false;
+    if (!geo.vbo || vertices > geo.vertexCapacity) {
+        geo.vertexCapacity = std::max(vertices, geo.vertexCapacity * 2);
+        grow(geo.vbo, geo.usedVertices * stride, geo.vertexCapacity * stride);
+        changed = true;
+    }
+    if (!geo.ebo || indices > geo.indexCapacity) {
+        geo.indexCapacity = std::max(indices, geo.indexCapacity * 2);
+        grow(geo.ebo, geo.usedIndices * sizeof(unsigned), geo.indexCapacity * sizeof(unsigned));
+        changed = true;
+    }
+    if (!changed)
+        return;
+
+    if (!geo.vao) {
+        unsigned vao;
+        glGenVertexArrays(1, &vao);
+        geo.vao.reset(vao);
+    }
+    GlState& gl = GlState::instance();
+    gl.bindVertexArray(geo.vao.get());
+    gl.bindBuffer(GL_ARRAY_BUFFER, geo.vbo.get());
+    gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, geo.ebo.get());
+    setupVertexAttributes(geo.vertexFormat);
+    gl.bindVertexArray(0);
+}
+
+// 把 mesh 接在 arena 已用區段之後，回傳上傳的 bytes
+size_t Model::uploadMesh(const MeshView& view, int textureSlot) {
+    ModelGeometry& geo = *geometry_;
+    if (view.format != geo.vertexFormat)
+        throw runtime_error("Mesh vertex format does not match model format");
+
+    const size_t stride = vertexStride(geo.vertexFormat);
+    size_t vertexBytes = view.vertexCount * stride;
+    size_t indexBytes = view.indexCount * sizeof(unsigned);
+    ScopedPhase phase(LoadPhase::GpuUpload, objPath_);
+    phase.addBytes(vertexBytes + indexBytes);
+
+    // 索引保持 mesh 內的相對值，繪製時以 base vertex 位移
+    Mesh mesh;
+    mesh.baseVertex = (int)geo.usedVertices;
+    mesh.firstIndex = (unsigned)geo.usedIndices;
+    mesh.indexCount = view.indexCount;
+    mesh.posOffset = view.posOffset;
+    mesh.posScale = view.posScale;
+    mesh.bounds = view.bounds;
+    mesh.textureSlot = textureSlot;
+    if (textureSlot >= (int)geo.textureHandles.size()) {
+        geo.textureHandles.resize(textureSlot + 1, -1);
+        geo.textureLayers.resize(textureSlot + 1);
+    }
+
+    GlState::instance().bindBuffer(GL_ARRAY_BUFFER, geo.vbo.get());
+    glBufferSubData(GL_ARRAY_BUFFER, geo.usedVertices * stride, vertexBytes, view.vertices);
+    GlState::instance().bindBuffer(GL_COPY_WRITE_BUFFER, geo.ebo.get());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, geo.usedIndices * sizeof(unsigned), indexBytes, view.indices);
+
+    geo.meshes.push_back(mesh);
+    geo.bounds.push(mesh.bounds);
+    geo.usedVertices += view.vertexCount;
+    geo.usedIndices += view.indexCount;
+    return vertexBytes + indexBytes;
+}
+
+// 幾何、貼圖參考與未完成的載入由 geometry_ 釋放（最後一個共用的 Model 解構時）
+Model::~Model() = default;
+
+ModelGeometry::ModelGeometry() = default;
+
+ModelGeometry::~ModelGeometry() {
+    if (load) {
+        load->cancel = true;
+        if (load->worker.joinable())
+            load->worker.join();
+    }
+    for (int handle : textureHandles)
+        textures->release(handle);
+}
+
+uint64_t ModelGeometry::bytes() const {
+    return (uint64_t)vertexCapacity * vertexStride(vertexFormat) + (uint64_t)indexCapacity * sizeof(unsigned) +
+           arrays.residentBytes();
+}
+
+Model::LodView Model::lodView(const glm::mat4& modelView, const glm::mat4& projection, int viewportHeight) {
+    LodView view;
+    view.modelView = modelView;
+    view.scale = std::max({glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1])),
+                           glm::length(glm::vec3(modelView[2]))});
+    view.pixelsPerUnit = 0.5f * projection[1][1] * (float)viewportHeight;
+    view.clip = projection * modelView;
+    return view;
+}
+
+void Model::setViewer(const glm::mat4& modelView, const glm::mat4& projection, int viewportHeight) {
+    lod_ = lodView(modelView, projection, viewportHeight);
+}
+
+void Model::prefetch(const glm::mat4& modelView, const glm::mat4& projection, int viewportHeight) {
+    const ModelGeometry& geo = *geometry_;
+    const LodView view = lodView(modelView, projection, viewportHeight);
+    cullBounds(geo.bounds, Frustum(view.clip), visible_);
+
+    for (size_t i = 0; i < geo.meshes.size(); i++) {
+        const Mesh& mesh = geo.meshes[i];
+        // 陣列貼圖常駐，不需預先載入
+        if (!visible_[i] || mesh.textureSlot < 0 || geo.textureLayers[mesh.textureSlot].group >= 0)
+            continue;
+        texCache_->prefetch(geo.textureHandles[mesh.textureSlot], uvPerPixel(mesh, view));
+    }
+}
+
+// 以包圍球最靠近相機的點估計（保守：偏向較細的 level）
+float Model::uvPerPixel(const Mesh& mesh, const LodView& view) {
+    if (view.pixelsPerUnit <= 0.0f || view.scale <= 0.0f || mesh.bounds.uvDensity <= 0.0f)
+        return 0.0f;
+    const glm::vec3 center = glm::vec3(view.modelView * glm::vec4(mesh.bounds.center, 1.0f));
+    const float distance = glm::length(center) - mesh.bounds.radius * view.scale;
+    if (distance <= 0.0f)
+        return 0.0f;
+    return mesh.bounds.uvDensity / view.scale * distance / view.pixelsPerUnit;
+}
+
+void Model::Draw(const Shader& shader) const {
+    enqueue(queue_, shader);
+    queue_.submit();
+    drawStats_.textureBinds = queue_.stats().textureBinds;
+}
+
+void Model::enqueue(RenderQueue& queue, const Shader& shader) const {
+    const ModelGeometry& geo = *geometry_;
+    drawStats_ = DrawStats();
+    if (!geo.vao)
+        return;
+
+    texCache_->beginFrame(this);
+    const bool packed = geo.vertexFormat != VertexFormat::Float32;
+    const unsigned program = shader.id();
+
+    // 陣列貼圖在 unit 1，以 uTextureLayer 選 layer；其餘在 unit 0（uTextureLayer = -1）
+    // 視錐外的 mesh 不送出，也不記錄貼圖使用（可被 LRU 降級）
+    const bool cull = lod_.pixelsPerUnit > 0.0f;
+    if (cull)
+        drawStats_.culled = geo.meshes.size() - cullBounds(geo.bounds, Frustum(lod_.clip), visible_);
+
+    DrawCommand command;
+    command.shader = &shader;
+    command.vao = geo.vao.get();
+    command.octNormalScale = octNormalScale(geo.vertexFormat);
+    for (size_t i = 0; i < geo.meshes.size(); i++) {
+        if (cull && !visible_[i])
+            continue;
+        const Mesh& mesh = geo.meshes[i];
+        const TextureLayer* where = mesh.textureSlot >= 0 ? &geo.textureLayers[mesh.textureSlot] : nullptr;
+        if (where && where->group >= 0) {
+            command.textureUnit = 1;
+            command.textureTarget = GL_TEXTURE_2D_ARRAY;
+            command.texture = geo.arrays.id(where->group);
+            command.textureLayer = where->layer;
+        } else {
+            unsigned tex = mesh.textureSlot >= 0 ? texCache_->use(geo.textureHandles[mesh.textureSlot], uvPerPixel(mesh, lod_)) : 0;
+            command.textureUnit = 0;
+            command.textureTarget = GL_TEXTURE_2D;
+            command.texture = tex ? tex : placeholder_->get();
+            command.textureLayer = -1;
+        }
+        if (packed) {
+            command.posOffset = mesh.posOffset;
+            command.posScale = mesh.posScale;
+        }
+        command.indexCount = mesh.indexCount;
+        command.firstIndex = mesh.firstIndex;
+        command.baseVertex = mesh.baseVertex;
 
-    for (const auto& mesh : meshes_) {
-        glActiveTexture(GL_TEXTURE0);
-        unsigned tex = mesh.textureID ? mesh.textureID : defaultTex;
-        glBindTexture(GL_TEXTURE_2D, tex);
-        glBindVertexArray(mesh.vao);
-        glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+        // 深度取包圍球中心在相機空間的距離（相機看向 -z）
+        const float depth = -(lod_.modelView * glm::vec4(mesh.bounds.center, 1.0f)).z;
+        queue.push(RenderQueue::makeKey(RenderPass::Opaque, program, command.texture, command.vao, depth), command);
+        drawStats_.draws++;
     }
 }
 
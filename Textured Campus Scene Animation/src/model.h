@@ -1,25 +1,138 @@
 #pragma once
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
+#include "frustum_cull.h"
+#include "gl_handle.h"
+#include "mesh_cache.h"
+#include "mesh_data.h"
+#include "render_queue.h"
+#include "shader.h"
+#include "texture_array.h"
 #include "texture_cache.h"
 
-// 單一 Mesh 結構
+// 單一 Mesh：在 Model 共用的頂點 / 索引緩衝中的區段
 struct Mesh {
-    unsigned vao = 0, vbo = 0, ebo = 0;
+    int baseVertex = 0;
+    unsigned firstIndex = 0;
     unsigned indexCount = 0;
-    unsigned textureID = 0;
+    int textureSlot = -1; // textureHandles_ 索引，-1 = 無貼圖
+    glm::vec3 posOffset{0.0f}; // 量化位置的解碼參數
+    glm::vec3 posScale{1.0f};
+    MeshBounds bounds; // 物件空間
 };
 
-// 模型載入與繪製
+// 載入流程選項
+struct ModelLoadOptions {
+    bool optimizeVertexCache = true;                // Forsyth 三角形重排 + vertex fetch 重排
+    VertexFormat vertexFormat = VertexFormat::Packed16; // GPU 頂點格式
+    bool async = false; // 在背景執行緒解析 / 解碼，由 update() 逐幀上傳
+    unsigned textureThreads = 0; // 貼圖解碼執行緒數，0 = hardware_concurrency，1 = 單執行緒基準
+    bool streamObj = false; // 以 FastObjReader::StreamFromFile 逐批解析，完成的材質區段立即送出（較省記憶體）
+    bool compressTextures = false; // 貼圖壓縮為 BC1 / BC3；不支援 S3TC 時退回 RGBA8
+    MipFilter mipFilter = MipFilter::Box; // CPU mip 鏈濾波器（結果與壓縮一併快取於 <貼圖>.texcache）
+    TextureSizePolicy textureSizes; // 依資產目錄的貼圖大小上限，過大者解碼後立即縮小
+    uint64_t textureBudgetBytes = 0; // 貼圖 VRAM 預算，超過時最久未繪製者降級為小 mip；0 = 不限
+    bool textureArrays = false; // 同尺寸貼圖打包為 GL_TEXTURE_2D_ARRAY，繪製時只換 layer uniform（開啟 mip 串流或 VRAM 預算時忽略）
+    bool streamTextureMips = false; // 依 setViewer 估計的螢幕 texel 密度逐幀載入所需 mip（先小後大）
+    size_t uploadRingBytes = 0; // 貼圖經由此大小的 PBO 環形緩衝非同步上傳；0 = 直接由用戶端記憶體上傳
+};
+
+struct ModelLoadState;
+
+// 模型的 GPU 資料；同一 OBJ 以相同頂點格式 / 選項載入的 Model 共用（見 ResourceManager），載入開始時即登記
+// 所有 mesh 依序放入同一組 VAO/VBO/EBO；釋放時取消未完成的載入，並釋放各 slot 的貼圖參考
+struct ModelGeometry {
+    ModelGeometry();
+    ~ModelGeometry();
+    ModelGeometry(const ModelGeometry&) = delete;
+    ModelGeometry& operator=(const ModelGeometry&) = delete;
+
+    // 緩衝與陣列貼圖的 GPU 佔用（不含 TextureCache 中的貼圖）
+    uint64_t bytes() const;
+
+    VertexFormat vertexFormat = VertexFormat::Float32;
+    GlVertexArray vao;
+    GlBuffer vbo, ebo;
+    size_t vertexCapacity = 0, indexCapacity = 0;
+    size_t usedVertices = 0, usedIndices = 0;
+    std::vector<Mesh> meshes; // 已上傳的 mesh
+    BoundsSoA bounds;         // 與 meshes 同索引，供視錐剔除
+    std::vector<int> textureHandles; // slot -> TextureCache handle（各持有一個參考），-1 = 尚未上傳
+    std::vector<TextureLayer> textureLayers; // slot -> 已上傳的陣列位置
+    std::vector<TextureLayer> arrayPlan;     // slot -> 預定的陣列位置
+    TextureArrays arrays;
+    std::shared_ptr<TextureCache> textures;
+    // 先載入者的貼圖解碼選項，上傳的貼圖重新載入時使用
+    std::shared_ptr<const TextureDecodeOptions> decodeOptions;
+    // 載入中的狀態，完成後釋放；共用此幾何的任一 Model 的 update 都會推進
+    std::unique_ptr<ModelLoadState> load;
+};
+
+// 最近一次 Draw 的統計
+struct DrawStats {
+    size_t draws = 0;
+    size_t culled = 0; // 包圍體在視錐外而略過的 mesh
+    size_t textureBinds = 0; // 只由 Draw 填入；經由外部 RenderQueue 時見其 stats()
+};
+
+// 模型載入與繪製；貼圖與幾何經由 ResourceManager 與其他 Model 共用
 class Model {
 public:
-    explicit Model(const std::string& objPath);
+    explicit Model(const std::string& objPath, const ModelLoadOptions& options = ModelLoadOptions());
     ~Model();
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // 每幀呼叫：上傳最多約 budgetBytes 的已就緒資料（至少一筆），全部完成時回傳 true
+    // 共用其他 Model 尚在載入的幾何時同樣推進該載入
+    bool update(size_t budgetBytes);
+    bool isLoaded() const { return !geometry_->load; }
 
-    void Draw() const;
+    // 設定之後 Draw 的觀察參數：剔除視錐外的 mesh，並供 mip 串流估計各 mesh 所需的貼圖 level
+    // modelView 為物件到相機空間，viewportHeight 以像素計；未設定時不剔除，且一律要求完整解析度
+    void setViewer(const glm::mat4& modelView, const glm::mat4& projection, int viewportHeight);
+    // 預測之後的觀察參數（如沿鏡頭路徑往前取樣）：包圍球在該視錐內的 mesh，
+    // 其貼圖提早在背景載入屆時所需的 level，並且不會被 LRU 降級；需在 Draw 之前呼叫，可每幀呼叫多次
+    void prefetch(const glm::mat4& modelView, const glm::mat4& projection, int viewportHeight);
+
+    // 只繪製已上傳的 mesh；貼圖未就緒者以灰色佔位
+    // 每次呼叫視為一幀：更新貼圖的最近使用時間，並重新載入被降級後又用到的貼圖
+    // 等同以內部佇列 enqueue 後立即 submit
+    void Draw(const Shader& shader) const;
+    // 把已上傳的 mesh 加入 queue（含 Draw 的貼圖使用紀錄），由呼叫端排序送出；多個 Model 可共用同一個 queue
+    // 深度排序使用 setViewer 的 modelView
+    void enqueue(RenderQueue& queue, const Shader& shader) const;
+
+    // 共用的 TextureCache 統計（包含其他 Model 的貼圖）
+    const TextureStats& textureStats() const { return texCache_->stats(); }
+    const DrawStats& drawStats() const { return drawStats_; }
 
 private:
-    std::vector<Mesh> meshes_;
-    TextureCache texCache_;
+    // 容量不足時整組搬移到較大的緩衝
+    void reserveArena(size_t vertices, size_t indices);
+    size_t uploadMesh(const MeshView& view, int textureSlot);
+    void setTexture(int slot, int handle);
+    // setViewer / prefetch 的觀察參數
+    struct LodView {
+        glm::mat4 modelView{1.0f};
+        float scale = 1.0f;         // modelView 的最大縮放
+        float pixelsPerUnit = 0.0f; // 距離 1 處每單位長度的像素數；0 = 未設定
+        glm::mat4 clip{1.0f};       // projection * modelView
+    };
+    static LodView lodView(const glm::mat4& modelView, const glm::mat4& projection, int viewportHeight);
+    // mesh 在螢幕上每個像素跨越的 UV 距離；0 = 無法估計（需要完整解析度）
+    static float uvPerPixel(const Mesh& mesh, const LodView& view);
+
+    std::string objPath_;
+    std::string geometryKey_;
+    std::shared_ptr<ModelGeometry> geometry_; // 載入開始時即登記到 ResourceManager
+    std::shared_ptr<TextureCache> texCache_;  // Draw 會更新 LRU 狀態
+    std::shared_ptr<GlTexture> placeholder_; // 貼圖未就緒時的灰色佔位
+    mutable DrawStats drawStats_;
+    mutable RenderQueue queue_; // Draw 用
+    mutable std::vector<uint8_t> visible_; // 每個 mesh 的剔除結果
+    LodView lod_;
 };
@@ -0,0 +1,719 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "obj_parser.h"
+#include "file_util.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <thread>
+
+namespace {
+
+// 單一區塊最小大小，太小的檔案不值得開執行緒
+const size_t kMinChunkBytes = 1 << 20;
+// 串流解析的區塊大小：同時只持有一批（執行緒數個）區塊的面資料
+const size_t kStreamChunkBytes = 8 << 20;
+
+enum Component { kPos = 0, kTex = 1, kNrm = 2 };
+
+// 相對索引（負值）需等知道前面區塊的數量後才能換算
+struct RelativeFixup {
+    size_t corner;
+    Component comp;
+};
+
+// 依出現順序記錄的 g / o / usemtl 事件
+struct Event {
+    enum Kind { Group, Material } kind;
+    size_t face;   // 事件發生時已解析的面數（解析後換算成輸出面數）
+    std::string name;
+};
+
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    // 第一階段：原始解析結果
+    std::vector<float> v, vt, vn;
+    std::vector<tinyobj::index_t> corners;
+    std::vector<unsigned> faceSizes;
+    std::vector<RelativeFixup> fixups;
+    std::vector<Event> events;
+    std::vector<std::string> mtllibs;
+
+    // 前面所有區塊的累計數量
+    size_t vBase = 0, vtBase = 0, vnBase = 0;
+
+    // 第二階段：三角化後的面
+    std::vector<tinyobj::index_t> outIndices;
+    std::vector<unsigned> outSizes;
+    size_t degenerate = 0;
+    size_t invalid = 0;
+};
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+inline bool isEol(char c) { return c == '\n' || c == '\r'; }
+inline bool isDigit(char c) { return (unsigned)(c - '0') < 10u; }
+
+inline const char* skipSpace(const char* p, const char* end)
+{
+    while (p < end && isSpace(*p))
+        p++;
+    return p;
+}
+
+// 快速浮點數解析（格式：[+-]digits[.digits][(e|E)[+-]digits]）
+// 以 64-bit 整數累積有效位數，再乘上 10 的次方，精度足以轉成 float
+const char* parseFloat(const char* p, const char* end, float& out)
+{
+    static const double kPow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    p = skipSpace(p, end);
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        neg = *p == '-';
+        p++;
+    }
+
+    uint64_t mant = 0;
+    int digits = 0;
+    int exp10 = 0;
+    bool any = false;
+    while (p < end && isDigit(*p))
+    {
+        if (digits < 19)
+        {
+            mant = mant * 10 + (uint64_t)(*p - '0');
+            if (mant)
+                digits++;
+        }
+        else
+            exp10++;
+        any = true;
+        p++;
+    }
+    if (p < end && *p == '.')
+    {
+        p++;
+        while (p < end && isDigit(*p))
+        {
+            if (digits < 19)
+            {
+                mant = mant * 10 + (uint64_t)(*p - '0');
+                if (mant)
+                    digits++;
+                exp10--;
+            }
+            any = true;
+            p++;
+        }
+    }
+    if (!any)
+        return nullptr;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool eneg = false;
+        if (q < end && (*q == '-' || *q == '+'))
+        {
+            eneg = *q == '-';
+            q++;
+        }
+        if (q < end && isDigit(*q))
+        {
+            int e = 0;
+            while (q < end && isDigit(*q))
+            {
+                if (e < 10000)
+                    e = e * 10 + (*q - '0');
+                q++;
+            }
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    double value = (double)mant;
+    if (exp10 >= 0 && exp10 <= 22)
+        value *= kPow10[exp10];
+    else if (exp10 < 0 && exp10 >= -22)
+        value /= kPow10[-exp10];
+    else
+        value *= std::pow(10.0, exp10);
+
+    out = (float)(neg ? -value : value);
+    return p;
+}
+
+const char* parseInt(const char* p, const char* end, int& out)
+{
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        neg = *p == '-';
+        p++;
+    }
+    if (p >= end || !isDigit(*p))
+        return nullptr;
+    int v = 0;
+    while (p < end && isDigit(*p))
+    {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+    out = neg ? -v : v;
+    return p;
+}
+
+// 讀取一行剩餘的字詞，以單一空白串接（與 tinyobj 的 g 名稱規則相同）
+std::string restOfLine(const char* p, const char* eol)
+{
+    std::string s;
+    while (p < eol)
+    {
+        p = skipSpace(p, eol);
+        const char* t = p;
+        while (t < eol && !isSpace(*t) && !isEol(*t))
+            t++;
+        if (t > p)
+        {
+            if (!s.empty())
+                s += ' ';
+            s.append(p, t);
+        }
+        p = t;
+        while (p < eol && isEol(*p))
+            p++;
+    }
+    return s;
+}
+
+// 將 OBJ 索引換算成 0-based；負值先以區塊內位置暫存，之後再補上 base
+int resolveIndex(int idx, size_t localCount, size_t corner, Component comp, Chunk& c)
+{
+    if (idx > 0)
+        return idx - 1;
+    if (idx < 0)
+    {
+        c.fixups.push_back({corner, comp});
+        return (int)localCount + idx;
+    }
+    return -1; // 0 不是合法索引
+}
+
+void parseFace(const char* p, const char* eol, Chunk& c)
+{
+    unsigned count = 0;
+    while (true)
+    {
+        p = skipSpace(p, eol);
+        if (p >= eol || isEol(*p) || *p == '#')
+            break;
+
+        tinyobj::index_t idx;
+        idx.vertex_index = idx.texcoord_index = idx.normal_index = -1;
+        size_t corner = c.corners.size();
+
+        int v;
+        const char* q = parseInt(p, eol, v);
+        if (!q)
+            break;
+        idx.vertex_index = resolveIndex(v, c.v.size() / 3, corner, kPos, c);
+        p = q;
+        if (p < eol && *p == '/')
+        {
+            p++;
+            if (p < eol && *p != '/')
+            {
+                if ((q = parseInt(p, eol, v)))
+                {
+                    idx.texcoord_index = resolveIndex(v, c.vt.size() / 2, corner, kTex, c);
+                    p = q;
+                }
+            }
+            if (p < eol && *p == '/')
+            {
+                p++;
+                if ((q = parseInt(p, eol, v)))
+                {
+                    idx.normal_index = resolveIndex(v, c.vn.size() / 3, corner, kNrm, c);
+                    p = q;
+                }
+            }
+        }
+        // 略過不認得的字元直到下個空白
+        while (p < eol && !isSpace(*p) && !isEol(*p))
+            p++;
+
+        c.corners.push_back(idx);
+        count++;
+    }
+    if (count)
+        c.faceSizes.push_back(count);
+}
+
+// 第一階段：解析單一區塊
+void parseChunk(Chunk& c)
+{
+    const char* p = c.begin;
+    const char* end = c.end;
+    while (p < end)
+    {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol)
+            eol = end;
+
+        const char* s = skipSpace(p, eol);
+        size_t len = eol - s;
+        if (len >= 2)
+        {
+            char c0 = s[0], c1 = s[1];
+            if (c0 == 'v' && isSpace(c1))
+            {
+                float x = 0, y = 0, z = 0;
+                const char* q = s + 2;
+                if ((q = parseFloat(q, eol, x)) && (q = parseFloat(q, eol, y)))
+                    parseFloat(q, eol, z);
+                c.v.push_back(x);
+                c.v.push_back(y);
+                c.v.push_back(z);
+            }
+            else if (c0 == 'v' && c1 == 'n' && len > 2 && isSpace(s[2]))
+            {
+                float x = 0, y = 0, z = 0;
+                const char* q = s + 3;
+                if ((q = parseFloat(q, eol, x)) && (q = parseFloat(q, eol, y)))
+                    parseFloat(q, eol, z);
+                c.vn.push_back(x);
+                c.vn.push_back(y);
+                c.vn.push_back(z);
+            }
+            else if (c0 == 'v' && c1 == 't' && len > 2 && isSpace(s[2]))
+            {
+                float u = 0, v = 0;
+                const char* q = s + 3;
+                if ((q = parseFloat(q, eol, u)))
+                    parseFloat(q, eol, v);
+                c.vt.push_back(u);
+                c.vt.push_back(v);
+            }
+            else if (c0 == 'f' && isSpace(c1))
+            {
+                parseFace(s + 2, eol, c);
+            }
+            else if ((c0 == 'g' || c0 == 'o') && isSpace(c1))
+            {
+                c.events.push_back({Event::Group, c.faceSizes.size(), restOfLine(s + 2, eol)});
+            }
+            else if (len > 7 && std::memcmp(s, "usemtl", 6) == 0 && isSpace(s[6]))
+            {
+                c.events.push_back({Event::Material, c.faceSizes.size(), restOfLine(s + 7, eol)});
+            }
+            else if (len > 7 && std::memcmp(s, "mtllib", 6) == 0 && isSpace(s[6]))
+            {
+                std::string names = restOfLine(s + 7, eol);
+                size_t a = 0;
+                while (a < names.size())
+                {
+                    size_t b = names.find(' ', a);
+                    if (b == std::string::npos)
+                        b = names.size();
+                    c.mtllibs.push_back(names.substr(a, b - a));
+                    a = b + 1;
+                }
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+// 第二階段：補上相對索引的 base 並三角化
+void triangulateChunk(Chunk& c, const std::vector<float>& positions, bool triangulate)
+{
+    for (const auto& f : c.fixups)
+    {
+        tinyobj::index_t& idx = c.corners[f.corner];
+        if (f.comp == kPos)
+            idx.vertex_index += (int)c.vBase;
+        else if (f.comp == kTex)
+            idx.texcoord_index += (int)c.vtBase;
+        else
+            idx.normal_index += (int)c.vnBase;
+    }
+
+    const size_t vertexCount = positions.size() / 3;
+    auto pos = [&](const tinyobj::index_t& i) {
+        const float* v = &positions[3 * (size_t)i.vertex_index];
+        return std::array<float, 3>{v[0], v[1], v[2]};
+    };
+    auto dist2 = [](const std::array<float, 3>& a, const std::array<float, 3>& b) {
+        float dx = b[0] - a[0], dy = b[1] - a[1], dz = b[2] - a[2];
+        return dx * dx + dy * dy + dz * dz;
+    };
+
+    c.outIndices.reserve(c.corners.size() * 3 / 2);
+    c.outSizes.reserve(c.faceSizes.size() * 2);
+
+    size_t nextEvent = 0;
+    size_t corner = 0;
+    for (size_t f = 0; f < c.faceSizes.size(); f++)
+    {
+        while (nextEvent < c.events.size() && c.events[nextEvent].face == f)
+            c.events[nextEvent++].face = c.outSizes.size();
+
+        unsigned n = c.faceSizes[f];
+        const tinyobj::index_t* in = &c.corners[corner];
+        corner += n;
+
+        if (n < 3)
+        {
+            c.degenerate++;
+            continue;
+        }
+        bool ok = true;
+        for (unsigned k = 0; k < n; k++)
+            if (in[k].vertex_index < 0 || (size_t)in[k].vertex_index >= vertexCount)
+                ok = false;
+        if (!ok)
+        {
+            c.invalid++;
+            continue;
+        }
+
+        if (!triangulate || n == 3)
+        {
+            c.outIndices.insert(c.outIndices.end(), in, in + n);
+            c.outSizes.push_back(n);
+        }
+        else if (n == 4)
+        {
+            // 與 tinyobj 相同：沿較短的對角線切開
+            if (dist2(pos(in[0]), pos(in[2])) < dist2(pos(in[1]), pos(in[3])))
+                c.outIndices.insert(c.outIndices.end(), {in[0], in[1], in[2], in[0], in[2], in[3]});
+            else
+                c.outIndices.insert(c.outIndices.end(), {in[0], in[1], in[3], in[1], in[2], in[3]});
+            c.outSizes.push_back(3);
+            c.outSizes.push_back(3);
+        }
+        else
+        {
+            // 多邊形以扇形三角化
+            for (unsigned k = 1; k + 1 < n; k++)
+            {
+                c.outIndices.insert(c.outIndices.end(), {in[0], in[k], in[k + 1]});
+                c.outSizes.push_back(3);
+            }
+        }
+    }
+    while (nextEvent < c.events.size())
+        c.events[nextEvent++].face = c.outSizes.size();
+
+    // 原始資料已不再需要
+    std::vector<tinyobj::index_t>().swap(c.corners);
+    std::vector<unsigned>().swap(c.faceSizes);
+    std::vector<RelativeFixup>().swap(c.fixups);
+}
+
+template <typename Fn>
+void parallelFor(size_t count, Fn fn)
+{
+    if (count <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(count - 1);
+    for (size_t i = 1; i < count; i++)
+        workers.emplace_back(fn, i);
+    fn(0);
+    for (auto& t : workers)
+        t.join();
+}
+
+void appendRange(tinyobj::shape_t& shape, const Chunk& c, size_t from, size_t to,
+                 size_t& cornerCursor, int material)
+{
+    if (to <= from)
+        return;
+    size_t corners = 0;
+    for (size_t f = from; f < to; f++)
+        corners += c.outSizes[f];
+
+    auto& m = shape.mesh;
+    m.indices.insert(m.indices.end(), c.outIndices.begin() + cornerCursor,
+                     c.outIndices.begin() + cornerCursor + corners);
+    m.num_face_vertices.insert(m.num_face_vertices.end(), c.outSizes.begin() + from,
+                               c.outSizes.begin() + to);
+    m.material_ids.insert(m.material_ids.end(), to - from, material);
+    m.smoothing_group_ids.insert(m.smoothing_group_ids.end(), to - from, 0u);
+    cornerCursor += corners;
+}
+
+// 依換行切成 count 塊（每塊結尾對齊到換行）
+std::vector<Chunk> splitChunks(const char* data, size_t size, size_t count)
+{
+    std::vector<Chunk> chunks(count);
+    const char* end = data + size;
+    const char* p = data;
+    for (size_t i = 0; i < count; i++)
+    {
+        const char* e = (i + 1 == count) ? end : data + size * (i + 1) / count;
+        if (e < p)
+            e = p;
+        if (e < end)
+        {
+            const char* nl = static_cast<const char*>(std::memchr(e, '\n', end - e));
+            e = nl ? nl + 1 : end;
+        }
+        chunks[i].begin = p;
+        chunks[i].end = e;
+        p = e;
+    }
+    return chunks;
+}
+
+// 依序把區塊的頂點屬性接到 attrib 之後並記下各區塊的 base，接完即釋放區塊內的副本
+void stitchAttributes(Chunk* chunks, size_t count, tinyobj::attrib_t& attrib)
+{
+    size_t nv = attrib.vertices.size(), nvt = attrib.texcoords.size(), nvn = attrib.normals.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        Chunk& c = chunks[i];
+        c.vBase = nv / 3;
+        c.vtBase = nvt / 2;
+        c.vnBase = nvn / 3;
+        nv += c.v.size();
+        nvt += c.vt.size();
+        nvn += c.vn.size();
+    }
+    attrib.vertices.resize(nv);
+    attrib.texcoords.resize(nvt);
+    attrib.normals.resize(nvn);
+    parallelFor(count, [&](size_t i) {
+        Chunk& c = chunks[i];
+        std::copy(c.v.begin(), c.v.end(), attrib.vertices.begin() + c.vBase * 3);
+        std::copy(c.vt.begin(), c.vt.end(), attrib.texcoords.begin() + c.vtBase * 2);
+        std::copy(c.vn.begin(), c.vn.end(), attrib.normals.begin() + c.vnBase * 3);
+        std::vector<float>().swap(c.v);
+        std::vector<float>().swap(c.vt);
+        std::vector<float>().swap(c.vn);
+    });
+}
+
+// 載入尚未載入過的 mtllib；回傳是否載入了新的材質檔
+bool loadMaterialLibs(const std::vector<std::string>& libs, tinyobj::MaterialFileReader& reader,
+                      std::set<std::string>& loaded, std::vector<tinyobj::material_t>& materials,
+                      std::map<std::string, int>& materialMap, std::string& warning)
+{
+    bool added = false;
+    for (const auto& lib : libs)
+    {
+        if (!loaded.insert(lib).second)
+            continue;
+        std::string warn, err;
+        if (!reader(lib, &materials, &materialMap, &warn, &err))
+            warning += "Failed to load material file: " + lib + "\n";
+        warning += warn;
+        warning += err;
+        added = true;
+    }
+    return added;
+}
+
+std::string materialSearchPath(const std::string& filename, const tinyobj::ObjReaderConfig& config)
+{
+    if (!config.mtl_search_path.empty())
+        return config.mtl_search_path;
+    size_t pos = filename.find_last_of("/\\");
+    return pos != std::string::npos ? filename.substr(0, pos) : std::string();
+}
+
+} // namespace
+
+bool FastObjReader::ParseFromFile(const std::string& filename,
+                                  const tinyobj::ObjReaderConfig& config,
+                                  unsigned threads)
+{
+    valid_ = false;
+    attrib_ = tinyobj::attrib_t();
+    shapes_.clear();
+    materials_.clear();
+    warning_.clear();
+    error_.clear();
+
+    MappedFile file(filename);
+    if (!file.valid())
+    {
+        error_ = "Cannot open file [" + filename + "]\n";
+        return false;
+    }
+
+    const std::string mtlSearchPath = materialSearchPath(filename, config);
+
+    // ---- 切塊：每塊結尾對齊到換行 ----
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t size = file.size();
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, size / kMinChunkBytes));
+    std::vector<Chunk> chunks = splitChunks(file.data(), size, chunkCount);
+
+    // ---- 第一階段：平行解析 ----
+    parallelFor(chunkCount, [&](size_t i) { parseChunk(chunks[i]); });
+
+    // ---- 拼接頂點屬性 ----
+    stitchAttributes(chunks.data(), chunkCount, attrib_);
+
+    // ---- 第二階段：平行三角化 ----
+    parallelFor(chunkCount, [&](size_t i) {
+        triangulateChunk(chunks[i], attrib_.vertices, config.triangulate);
+    });
+
+    // ---- 材質 ----
+    std::map<std::string, int> materialMap;
+    {
+        tinyobj::MaterialFileReader reader(mtlSearchPath);
+        std::set<std::string> loaded;
+        for (const auto& c : chunks)
+            loadMaterialLibs(c.mtllibs, reader, loaded, materials_, materialMap, warning_);
+    }
+
+    // ---- 依事件順序組成 shape ----
+    tinyobj::shape_t shape;
+    int material = -1;
+    std::set<std::string> missingMaterials;
+    size_t degenerate = 0, invalid = 0;
+    for (const auto& c : chunks)
+    {
+        size_t from = 0;
+        size_t cornerCursor = 0;
+        for (const auto& ev : c.events)
+        {
+            appendRange(shape, c, from, ev.face, cornerCursor, material);
+            from = ev.face;
+
+            if (ev.kind == Event::Group)
+            {
+                if (!shape.mesh.indices.empty())
+                    shapes_.push_back(std::move(shape));
+                shape = tinyobj::shape_t();
+                shape.name = ev.name;
+            }
+            else
+            {
+                auto it = materialMap.find(ev.name);
+                material = it != materialMap.end() ? it->second : -1;
+                if (it == materialMap.end() && missingMaterials.insert(ev.name).second)
+                    warning_ += "material [ '" + ev.name + "' ] not found in .mtl\n";
+            }
+        }
+        appendRange(shape, c, from, c.outSizes.size(), cornerCursor, material);
+        degenerate += c.degenerate;
+        invalid += c.invalid;
+    }
+    if (!shape.mesh.indices.empty())
+        shapes_.push_back(std::move(shape));
+
+    if (degenerate)
+        warning_ += "Degenerated face found: " + std::to_string(degenerate) + "\n";
+    if (invalid)
+        warning_ += "Face with invalid vertex index found: " + std::to_string(invalid) + "\n";
+
+    valid_ = true;
+    return true;
+}
+
+bool FastObjReader::StreamFromFile(const std::string& filename, const FastObjCallbacks& callbacks,
+                                   const tinyobj::ObjReaderConfig& config, unsigned threads)
+{
+    valid_ = false;
+    attrib_ = tinyobj::attrib_t();
+    shapes_.clear();
+    materials_.clear();
+    warning_.clear();
+    error_.clear();
+
+    MappedFile file(filename);
+    if (!file.valid())
+    {
+        error_ = "Cannot open file [" + filename + "]\n";
+        return false;
+    }
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* data = file.data();
+    size_t size = file.size();
+    size_t chunkCount = std::max<size_t>(1, (size + kStreamChunkBytes - 1) / kStreamChunkBytes);
+    std::vector<Chunk> chunks = splitChunks(data, size, chunkCount);
+
+    tinyobj::MaterialFileReader reader(materialSearchPath(filename, config));
+    std::set<std::string> loaded;
+    std::map<std::string, int> materialMap;
+    std::set<std::string> missingMaterials;
+    size_t degenerate = 0, invalid = 0;
+
+    // 每批 threads 個區塊：平行解析、拼接屬性、平行三角化，再依檔案順序回報並釋放
+    for (size_t first = 0; first < chunkCount; first += threads)
+    {
+        const size_t count = std::min<size_t>(threads, chunkCount - first);
+        Chunk* batch = &chunks[first];
+        parallelFor(count, [&](size_t i) { parseChunk(batch[i]); });
+        stitchAttributes(batch, count, attrib_);
+        parallelFor(count, [&](size_t i) { triangulateChunk(batch[i], attrib_.vertices, true); });
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (loadMaterialLibs(batch[i].mtllibs, reader, loaded, materials_, materialMap, warning_) &&
+                callbacks.materials)
+                callbacks.materials(materials_);
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            Chunk& c = batch[i];
+            size_t from = 0;
+            auto emit = [&](size_t to) {
+                // 一律三角化，每個面 3 個索引
+                if (to > from && callbacks.triangles)
+                    callbacks.triangles(&c.outIndices[from * 3], (to - from) * 3, attrib_);
+                from = to;
+            };
+            for (const auto& ev : c.events)
+            {
+                emit(ev.face);
+                if (ev.kind != Event::Material)
+                    continue;
+                auto it = materialMap.find(ev.name);
+                if (it == materialMap.end() && missingMaterials.insert(ev.name).second)
+                    warning_ += "material [ '" + ev.name + "' ] not found in .mtl\n";
+                if (callbacks.useMaterial)
+                    callbacks.useMaterial(it != materialMap.end() ? it->second : -1);
+            }
+            emit(c.outSizes.size());
+            degenerate += c.degenerate;
+            invalid += c.invalid;
+            if (callbacks.chunkDone)
+                callbacks.chunkDone();
+
+            file.release((size_t)(c.begin - data), (size_t)(c.end - c.begin));
+            c = Chunk();
+        }
+    }
+
+    if (degenerate)
+        warning_ += "Degenerated face found: " + std::to_string(degenerate) + "\n";
+    if (invalid)
+        warning_ += "Face with invalid vertex index found: " + std::to_string(invalid) + "\n";
+
+    valid_ = true;
+    return true;
+}
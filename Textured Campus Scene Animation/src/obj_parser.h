@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <tiny_obj_loader.h>
+
+// FastObjReader::StreamFromFile 的回呼，依檔案順序在呼叫端執行緒呼叫；未設定者略過
+struct FastObjCallbacks {
+    // 載入新的 mtllib 後呼叫，傳入目前為止的所有材質
+    std::function<void(const std::vector<tinyobj::material_t>& materials)> materials;
+    // usemtl：tinyobj 的材質 id，找不到時為 -1
+    std::function<void(int material)> useMaterial;
+    // 一段三角形（count 為 3 的倍數），索引為 0-based 全域索引；attrib 含目前為止解析的所有頂點屬性
+    std::function<void(const tinyobj::index_t* corners, size_t count, const tinyobj::attrib_t& attrib)> triangles;
+    // 一個區塊的面已全部送出
+    std::function<void()> chunkDone;
+};
+
+// 多執行緒 OBJ 解析器（可取代 tinyobj::ObjReader）
+// - mmap 整個檔案，依換行切成多個區塊平行解析 v / vn / vt / f
+// - 自訂浮點數解析，不經過 iostream
+// - 結果拼接成與 tinyobj 相同的 attrib_t / shape_t / material_t
+//   （三角形與四邊形的切法與 tinyobj 一致，五邊以上改用扇形切分）
+// 只保留繪製所需資料：不解析頂點顏色、w 分量、smoothing group 與線段 / 點
+class FastObjReader {
+public:
+    // threads = 0 表示使用 hardware_concurrency
+    bool ParseFromFile(const std::string& filename,
+                       const tinyobj::ObjReaderConfig& config = tinyobj::ObjReaderConfig(),
+                       unsigned threads = 0);
+
+    // 串流解析：依換行切成固定大小的區塊，每批（threads 個）平行解析與三角化後依序回報再釋放，
+    // 同時只持有一批區塊的面資料；一律三角化，不產生 shape_t。頂點屬性仍累積在 GetAttrib()，
+    // 面只能引用之前已出現的頂點
+    bool StreamFromFile(const std::string& filename, const FastObjCallbacks& callbacks,
+                        const tinyobj::ObjReaderConfig& config = tinyobj::ObjReaderConfig(),
+                        unsigned threads = 0);
+
+    bool Valid() const { return valid_; }
+    const tinyobj::attrib_t& GetAttrib() const { return attrib_; }
+    const std::vector<tinyobj::shape_t>& GetShapes() const { return shapes_; }
+    const std::vector<tinyobj::material_t>& GetMaterials() const { return materials_; }
+    const std::string& Warning() const { return warning_; }
+    const std::string& Error() const { return error_; }
+
+private:
+    bool valid_ = false;
+    tinyobj::attrib_t attrib_;
+    std::vector<tinyobj::shape_t> shapes_;
+    std::vector<tinyobj::material_t> materials_;
+    std::string warning_;
+    std::string error_;
+};
@@ -0,0 +1,171 @@
+#include "render_queue.h"
+#include "gl_state.h"
+#include "shader.h"
+#include <OpenGL/gl3.h>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+
+const int kDigitBits = 8;
+const int kDigits = 64 / kDigitBits;
+const int kBuckets = 1 << kDigitBits;
+// 少於此數時直方圖的固定成本較高，改用插入排序
+const size_t kSmallQueue = 64;
+
+uint64_t field(unsigned value, int bits)
+{
+    return (uint64_t)value & ((1ull << bits) - 1);
+}
+
+} // namespace
+
+uint64_t RenderQueue::makeKey(RenderPass pass, unsigned program, unsigned texture, unsigned vao, float viewDepth)
+{
+    // 正浮點數的位元順序與數值順序相同，取最高 16 位元（指數 + 7 位尾數）即為對數分佈的深度桶
+    uint32_t depthBits = 0;
+    if (viewDepth > 0.0f)
+        std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+    return field((unsigned)pass, 4) << 60 | field(program, 12) << 48 | field(texture, 20) << 28 |
+           field(vao, 12) << 16 | (depthBits >> 16);
+}
+
+void RenderQueue::push(uint64_t key, const DrawCommand &command)
+{
+    keys_.push_back(key);
+    commands_.push_back(command);
+}
+
+void RenderQueue::sort()
+{
+    const size_t n = keys_.size();
+    order_.resize(n);
+    for (size_t i = 0; i < n; i++)
+        order_[i] = (uint32_t)i;
+
+    if (n < kSmallQueue)
+    {
+        for (size_t i = 1; i < n; i++)
+        {
+            const uint64_t key = keys_[i];
+            const uint32_t index = order_[i];
+            size_t j = i;
+            for (; j > 0 && keys_[j - 1] > key; j--)
+            {
+                keys_[j] = keys_[j - 1];
+                order_[j] = order_[j - 1];
+            }
+            keys_[j] = key;
+            order_[j] = index;
+        }
+        return;
+    }
+
+    keyScratch_.resize(n);
+    orderScratch_.resize(n);
+
+    // 一次掃描取得所有位數的直方圖
+    counts_.assign((size_t)kDigits * kBuckets, 0);
+    for (uint64_t key : keys_)
+    {
+        for (int d = 0; d < kDigits; d++)
+            counts_[(size_t)d * kBuckets + ((key >> (d * kDigitBits)) & (kBuckets - 1))]++;
+    }
+
+    for (int d = 0; d < kDigits; d++)
+    {
+        size_t *count = &counts_[(size_t)d * kBuckets];
+        const uint64_t sample = n ? (keys_[0] >> (d * kDigitBits)) & (kBuckets - 1) : 0;
+        if (count[sample] == n)
+            continue;
+
+        size_t offset = 0;
+        for (int b = 0; b < kBuckets; b++)
+        {
+            const size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            const size_t dst = count[(keys_[i] >> (d * kDigitBits)) & (kBuckets - 1)]++;
+            keyScratch_[dst] = keys_[i];
+            orderScratch_[dst] = order_[i];
+        }
+        keys_.swap(keyScratch_);
+        order_.swap(orderScratch_);
+    }
+}
+
+void RenderQueue::submit()
+{
+    stats_ = RenderQueueStats();
+    stats_.commands = keys_.size();
+
+    const auto sortStart = std::chrono::steady_clock::now();
+    sort();
+    stats_.sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+
+    GlState &gl = GlState::instance();
+    const Shader *shader = nullptr;
+    int locLayer = -1, locOctScale = -1, locOffset = -1, locScale = -1;
+    // 目前 program 上各 uniform 的值；換 program 後一律重新設定
+    bool known = false;
+    int layer = 0;
+    float octScale = 0.0f;
+    glm::vec3 offset(0.0f), scale(0.0f);
+    unsigned vao = ~0u;
+
+    for (uint32_t index : order_)
+    {
+        const DrawCommand &c = commands_[index];
+        if (c.shader != shader)
+        {
+            shader = c.shader;
+            shader->use();
+            locLayer = shader->location("uTextureLayer");
+            locOctScale = shader->location("uOctNormalScale");
+            locOffset = shader->location("uPosOffset");
+            locScale = shader->location("uPosScale");
+            known = false;
+            stats_.programChanges++;
+        }
+        if (c.vao != vao)
+        {
+            gl.bindVertexArray(c.vao);
+            vao = c.vao;
+            stats_.vaoChanges++;
+        }
+        if (gl.bindTexture(c.textureUnit, c.textureTarget, c.texture))
+            stats_.textureBinds++;
+
+        if (!known || c.textureLayer != layer)
+        {
+            glUniform1i(locLayer, c.textureLayer);
+            layer = c.textureLayer;
+            stats_.uniformSets++;
+        }
+        if (!known || c.octNormalScale != octScale)
+        {
+            glUniform1f(locOctScale, c.octNormalScale);
+            octScale = c.octNormalScale;
+            stats_.uniformSets++;
+        }
+        if (!known || c.posOffset != offset || c.posScale != scale)
+        {
+            glUniform3fv(locOffset, 1, &c.posOffset[0]);
+            glUniform3fv(locScale, 1, &c.posScale[0]);
+            offset = c.posOffset;
+            scale = c.posScale;
+            stats_.uniformSets += 2;
+        }
+        known = true;
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, c.indexCount, GL_UNSIGNED_INT,
+                                 (void *)(c.firstIndex * sizeof(unsigned)), c.baseVertex);
+    }
+
+    keys_.clear();
+    commands_.clear();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Shader;
+
+// 排序鍵最高位：一個 pass 全部畫完才換下一個
+enum class RenderPass : uint32_t {
+    Opaque = 0, // 由近到遠
+};
+
+// 一次 glDrawElementsBaseVertex 所需的狀態
+struct DrawCommand {
+    const Shader* shader = nullptr;
+    unsigned vao = 0;
+    int textureUnit = 0;
+    unsigned textureTarget = 0; // GL_TEXTURE_2D / GL_TEXTURE_2D_ARRAY
+    unsigned texture = 0;
+    int textureLayer = -1;       // uTextureLayer
+    float octNormalScale = 0.0f; // uOctNormalScale
+    glm::vec3 posOffset{0.0f};   // uPosOffset / uPosScale
+    glm::vec3 posScale{1.0f};
+    unsigned indexCount = 0;
+    unsigned firstIndex = 0;
+    int baseVertex = 0;
+};
+
+// 最近一次 submit 的統計
+struct RenderQueueStats {
+    size_t commands = 0;
+    double sortMs = 0.0;
+    size_t programChanges = 0;
+    size_t vaoChanges = 0;
+    size_t textureBinds = 0;
+    size_t uniformSets = 0;
+};
+
+// 收集一幀內（可跨多個 Model）的繪製命令，依 64 位元排序鍵 radix sort 後送出，使狀態切換最少
+// 鍵由高到低：pass(4) | program(12) | texture(20) | VAO(12) | 深度桶(16)
+// GL 名稱只取低位元，碰撞只影響分組效果，不影響正確性；submit 需在 GL thread 呼叫
+class RenderQueue {
+public:
+    // viewDepth 為相機空間中到相機的距離（<= 0 視為 0），以浮點數的指數與高位尾數分桶（近處較細）
+    static uint64_t makeKey(RenderPass pass, unsigned program, unsigned texture, unsigned vao, float viewDepth);
+
+    void push(uint64_t key, const DrawCommand& command);
+    size_t size() const { return keys_.size(); }
+    // 依鍵排序（相同鍵保持加入順序）並送出，之後佇列清空
+    void submit();
+    const RenderQueueStats& stats() const { return stats_; }
+
+private:
+    // 8 bits 一位數的 LSD radix sort，所有鍵在該位數相同時略過；命令很少時改用插入排序
+    void sort();
+
+    std::vector<uint64_t> keys_;
+    std::vector<DrawCommand> commands_;
+    std::vector<uint32_t> order_;
+    std::vector<uint64_t> keyScratch_;
+    std::vector<uint32_t> orderScratch_;
+    std::vector<size_t> counts_; // 各位數的直方圖
+    RenderQueueStats stats_;
+};
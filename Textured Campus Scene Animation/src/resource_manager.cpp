@@ -0,0 +1,128 @@
+#include "resource_manager.h"
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include "model.h"
+#include "shader.h"
+#include "texture_cache.h"
+#include <OpenGL/gl3.h>
+#include <iomanip>
+
+ResourceManager& ResourceManager::instance()
+{
+    static ResourceManager manager;
+    return manager;
+}
+
+std::shared_ptr<TextureCache> ResourceManager::textureCache()
+{
+    std::shared_ptr<TextureCache> cache = textures_.lock();
+    if (!cache)
+    {
+        cache = std::make_shared<TextureCache>();
+        textures_ = cache;
+    }
+    return cache;
+}
+
+std::shared_ptr<Shader> ResourceManager::shader(const std::string& vertexPath, const std::string& fragmentPath,
+                                                const std::string& defines)
+{
+    std::weak_ptr<Shader>& slot = shaders_[std::make_tuple(vertexPath, fragmentPath, defines)];
+    std::shared_ptr<Shader> program = slot.lock();
+    if (!program)
+    {
+        program = std::make_shared<Shader>(vertexPath.c_str(), fragmentPath.c_str(), defines);
+        slot = program;
+    }
+    return program;
+}
+
+std::shared_ptr<FrameUniforms> ResourceManager::frameUniforms()
+{
+    std::shared_ptr<FrameUniforms> uniforms = frameUniforms_.lock();
+    if (!uniforms)
+    {
+        uniforms = std::make_shared<FrameUniforms>();
+        frameUniforms_ = uniforms;
+    }
+    return uniforms;
+}
+
+std::shared_ptr<GlTexture> ResourceManager::placeholderTexture()
+{
+    std::shared_ptr<GlTexture> texture = placeholder_.lock();
+    if (!texture)
+    {
+        unsigned char gray[3] = {128, 128, 128};
+        unsigned tex;
+        glGenTextures(1, &tex);
+        GlState::instance().bindTexture(0, GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, gray);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        texture = std::make_shared<GlTexture>(tex);
+        placeholder_ = texture;
+    }
+    return texture;
+}
+
+std::shared_ptr<ModelGeometry> ResourceManager::geometry(const std::string& key)
+{
+    auto it = geometries_.find(key);
+    return it != geometries_.end() ? it->second.lock() : nullptr;
+}
+
+void ResourceManager::addGeometry(const std::string& key, const std::shared_ptr<ModelGeometry>& geometry)
+{
+    prune();
+    geometries_[key] = geometry;
+}
+
+void ResourceManager::prune()
+{
+    for (auto it = shaders_.begin(); it != shaders_.end();)
+        it = it->second.expired() ? shaders_.erase(it) : std::next(it);
+    for (auto it = geometries_.begin(); it != geometries_.end();)
+        it = it->second.expired() ? geometries_.erase(it) : std::next(it);
+}
+
+std::vector<ResourceInfo> ResourceManager::resources()
+{
+    prune();
+    std::vector<ResourceInfo> out;
+    if (std::shared_ptr<TextureCache> cache = textures_.lock())
+    {
+        for (const auto& texture : cache->resources())
+            out.push_back({"texture", texture.path, texture.refs, texture.bytes});
+    }
+    for (const auto& [key, weak] : geometries_)
+    {
+        if (std::shared_ptr<ModelGeometry> geometry = weak.lock())
+            out.push_back({"geometry", key, weak.use_count() - 1, geometry->bytes()});
+    }
+    for (const auto& [key, weak] : shaders_)
+    {
+        const auto& [vertexPath, fragmentPath, defines] = key;
+        std::string name = vertexPath + " + " + fragmentPath;
+        if (!defines.empty())
+            name += " [" + defines.substr(0, defines.find_last_not_of('\n') + 1) + "]";
+        out.push_back({"shader", name, weak.use_count(), 0});
+    }
+    if (!frameUniforms_.expired())
+        out.push_back({"uniforms", FrameUniforms::kBlockName, frameUniforms_.use_count(),
+                       sizeof(FrameUniforms::Block)});
+    return out;
+}
+
+void ResourceManager::printResources(std::ostream& out)
+{
+    const std::vector<ResourceInfo> list = resources();
+    uint64_t total = 0;
+    for (const auto& info : list)
+    {
+        out << std::setw(9) << std::left << info.kind << " refs " << std::setw(3) << info.refs << " "
+            << std::setw(9) << std::right << info.bytes / 1024 << " KB  " << info.name << std::endl;
+        total += info.bytes;
+    }
+    out << "Resources: " << list.size() << " live, " << total / (1024 * 1024) << " MB" << std::endl;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "gl_handle.h"
+
+class FrameUniforms;
+class Shader;
+class TextureCache;
+struct ModelGeometry;
+
+// 一項共用資源的參考數與 GPU 佔用（除錯用）
+struct ResourceInfo {
+    std::string kind; // "texture" / "geometry" / "shader" / "uniforms"
+    std::string name;
+    long refs = 0;
+    uint64_t bytes = 0;
+};
+
+// 全程式共用的 GPU 資源：貼圖快取、已載入模型的幾何、shader program 與每幀 uniform buffer
+// 以 shared_ptr 計算參考，最後一個使用者釋放時立即刪除 GL 物件，因此使用者需在 GL context 結束前釋放；
+// 管理器只保留 weak_ptr，不延長資源壽命。需在 GL thread 呼叫
+class ResourceManager {
+public:
+    static ResourceManager& instance();
+
+    // 所有 Model 共用的貼圖快取（貼圖本身另有各自的參考數）
+    std::shared_ptr<TextureCache> textureCache();
+    // 相同檔案與 defines 的 shader 只編譯一次；失敗時拋出例外
+    std::shared_ptr<Shader> shader(const std::string& vertexPath, const std::string& fragmentPath,
+                                   const std::string& defines = std::string());
+    // 所有 program 共用的每幀 uniform block；一幀更新一次
+    std::shared_ptr<FrameUniforms> frameUniforms();
+    // 貼圖未就緒時使用的 1x1 灰色貼圖
+    std::shared_ptr<GlTexture> placeholderTexture();
+
+    // key 對應且仍在使用中的模型幾何（可能尚在載入，見 ModelGeometry::load）；沒有時回傳 nullptr
+    std::shared_ptr<ModelGeometry> geometry(const std::string& key);
+    // 載入開始時登記幾何，之後相同 key 的 Model 直接共用，並一起推進尚未完成的載入
+    void addGeometry(const std::string& key, const std::shared_ptr<ModelGeometry>& geometry);
+
+    // 目前存活的資源（貼圖的 refs 為持有 handle 的幾何數，其餘為 shared_ptr 使用者數）
+    std::vector<ResourceInfo> resources();
+    void printResources(std::ostream& out);
+
+private:
+    // 刪除已釋放資源留下的 weak_ptr
+    void prune();
+
+    std::weak_ptr<TextureCache> textures_;
+    std::weak_ptr<GlTexture> placeholder_;
+    std::weak_ptr<FrameUniforms> frameUniforms_;
+    std::map<std::tuple<std::string, std::string, std::string>, std::weak_ptr<Shader>> shaders_;
+    std::map<std::string, std::weak_ptr<ModelGeometry>> geometries_;
+};
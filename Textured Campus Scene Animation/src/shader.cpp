@@ -1,4 +1,6 @@
 #include "shader.h"
+#include "frame_uniforms.h"
+#include "gl_state.h"
 #include <OpenGL/gl3.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <fstream>
@@ -16,6 +18,18 @@ static std::string readFile(const char *path)
     return ss.str();
 }
 
+// 把 defines 插在 #version 那一行之後
+static std::string withDefines(const std::string &src, const std::string &defines)
+{
+    if (defines.empty())
+        return src;
+    size_t pos = src.find("#version");
+    pos = pos == std::string::npos ? 0 : src.find('\n', pos);
+    if (pos == std::string::npos)
+        return src + "\n" + defines;
+    return src.substr(0, pos + 1) + defines + src.substr(pos + 1);
+}
+
 static unsigned int compileStage(GLenum type, const char *src)
 {
     unsigned int shader = glCreateShader(type);
@@ -34,15 +48,16 @@ static unsigned int compileStage(GLenum type, const char *src)
     return shader;
 }
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath)
+Shader::Shader(const char *vertexPath, const char *fragmentPath, const std::string &defines)
 {
-    std::string vSrc = readFile(vertexPath);
-    std::string fSrc = readFile(fragmentPath);
+    std::string vSrc = withDefines(readFile(vertexPath), defines);
+    std::string fSrc = withDefines(readFile(fragmentPath), defines);
 
     unsigned int vs = compileStage(GL_VERTEX_SHADER, vSrc.c_str());
     unsigned int fs = compileStage(GL_FRAGMENT_SHADER, fSrc.c_str());
 
-    id = glCreateProgram();
+    program_.reset(glCreateProgram());
+    const unsigned int id = program_.get();
     glAttachShader(id, vs);
     glAttachShader(id, fs);
     glLinkProgram(id);
@@ -60,35 +75,79 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
 
     glDeleteShader(vs);
     glDeleteShader(fs);
+    reflect();
 }
 
-Shader::~Shader()
+void Shader::reflect()
 {
-    if (id)
-        glDeleteProgram(id);
+    const unsigned int id = program_.get();
+    int count = 0, maxLength = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string name(maxLength > 0 ? maxLength : 1, '\0');
+    for (int i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+        const std::string uniform(name.data(), length);
+        // uniform block 的成員沒有 location
+        const int location = glGetUniformLocation(id, uniform.c_str());
+        if (location < 0)
+            continue;
+        locations_[uniform] = location;
+        // 陣列回報為 "name[0]"，也接受不帶索引的名稱
+        const size_t bracket = uniform.find('[');
+        if (bracket != std::string::npos)
+            locations_.emplace(uniform.substr(0, bracket), location);
+    }
+
+    const unsigned int block = glGetUniformBlockIndex(id, FrameUniforms::kBlockName);
+    frameBlock_ = block != GL_INVALID_INDEX;
+    if (frameBlock_)
+        glUniformBlockBinding(id, block, FrameUniforms::kBinding);
 }
 
 void Shader::use() const
 {
-    glUseProgram(id);
+    GlState::instance().useProgram(program_.get());
+}
+
+int Shader::location(const char *name) const
+{
+    auto it = locations_.find(name);
+    return it != locations_.end() ? it->second : -1;
 }
 
 void Shader::setMat4(const char *name, const glm::mat4 &value) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(id, name), 1, GL_FALSE, glm::value_ptr(value));
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setMat3(const char *name, const glm::mat3 &value) const
+{
+    glUniformMatrix3fv(location(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
 void Shader::setVec3(const char *name, const glm::vec3 &value) const
 {
-    glUniform3fv(glGetUniformLocation(id, name), 1, &value[0]);
+    glUniform3fv(location(name), 1, &value[0]);
 }
 
 void Shader::setInt(const char *name, int value) const
 {
-    glUniform1i(glGetUniformLocation(id, name), value);
+    glUniform1i(location(name), value);
 }
 
 void Shader::setFloat(const char *name, float value) const
 {
-    glUniform1f(glGetUniformLocation(id, name), value);
+    glUniform1f(location(name), value);
+}
+
+void Shader::setModel(const glm::mat4 &model) const
+{
+    setMat4("model", model);
+    // 每物件求一次反矩陣，取代 vertex shader 中每個頂點的 transpose(inverse(model))
+    setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
 }
@@ -1,19 +1,43 @@
 #pragma once
+#include <functional>
+#include <map>
 #include <string>
 #include <glm/glm.hpp>
+#include "gl_handle.h"
 
 // GLSL 編譯與 uniform 設定管理
+// 連結後一次查詢所有 active uniform 的 location，set* 不再呼叫 glGetUniformLocation；
+// 若程式宣告了 FrameUniforms 的 block，連結時即綁到其綁定點
+//
+// shader 輸入約定（本專案與 hw1 / hw2 viewer 的所有 program 相同）：
+// - 每幀：Frame block（view / projection / cameraPos / lightDir），由 FrameUniforms 上傳
+// - 每物件：mat4 model 與 mat3 normalMatrix（model 左上 3x3 的反轉置），以 setModel 在 CPU 算好一起設定
+// shader 內不做矩陣求反
 class Shader
 {
 public:
-    unsigned int id = 0;
+    // defines 插在兩個 stage 的 #version 之後（如 "#define FOO\n"）
+    Shader(const char *vertexPath, const char *fragmentPath, const std::string &defines = std::string());
 
-    Shader(const char *vertexPath, const char *fragmentPath);
-    ~Shader();
+    unsigned int id() const { return program_.get(); }
 
     void use() const;
+    // 不存在（或被編譯器最佳化掉）的 uniform 回傳 -1，對其設定會被 GL 忽略
+    int location(const char *name) const;
+    bool hasFrameBlock() const { return frameBlock_; }
+
     void setMat4(const char *name, const glm::mat4 &value) const;
+    void setMat3(const char *name, const glm::mat3 &value) const;
     void setVec3(const char *name, const glm::vec3 &value) const;
     void setInt(const char *name, int value) const;
     void setFloat(const char *name, float value) const;
+    // 設定 model 與對應的 normalMatrix
+    void setModel(const glm::mat4 &model) const;
+
+private:
+    void reflect();
+
+    GlProgram program_;
+    std::map<std::string, int, std::less<>> locations_;
+    bool frameBlock_ = false;
 };
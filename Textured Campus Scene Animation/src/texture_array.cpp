@@ -0,0 +1,171 @@
+#include "texture_array.h"
+#include "gl_state.h"
+#include "load_profiler.h"
+#include "upload_ring.h"
+#include <OpenGL/gl3.h>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <stb_image.h>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace
+{
+
+GLenum pixelFormat(int channels)
+{
+    switch (channels)
+    {
+    case 1:
+        return GL_RED;
+    case 2:
+        return GL_RG;
+    case 4:
+        return GL_RGBA;
+    default:
+        return GL_RGB;
+    }
+}
+
+uint64_t blockBytes(TextureCodec codec, int width, int height)
+{
+    return (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * (codec == TextureCodec::BC3 ? 16 : 8);
+}
+
+} // namespace
+
+std::vector<TextureLayer> TextureArrays::plan(const std::vector<std::string> &paths, std::vector<Group> &groups,
+                                              const TextureSizePolicy &sizes)
+{
+    // (寬, 高, channels) -> 路徑索引
+    std::map<std::tuple<int, int, int>, std::vector<size_t>> bySize;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        int w, h, n;
+        if (!stbi_info(paths[i].c_str(), &w, &h, &n))
+            continue;
+        sizes.limitFor(paths[i]).fit(w, h, w, h);
+        bySize[std::make_tuple(w, h, n)].push_back(i);
+    }
+
+    std::vector<TextureLayer> where(paths.size());
+    groups.clear();
+    for (const auto &[key, members] : bySize)
+    {
+        if (members.size() < 2)
+            continue;
+        for (size_t first = 0; first < members.size(); first += kMaxLayers)
+        {
+            const size_t count = std::min<size_t>(kMaxLayers, members.size() - first);
+            if (count < 2)
+                break;
+            Group group;
+            std::tie(group.width, group.height, group.channels) = key;
+            group.layers = (int)count;
+            for (size_t k = 0; k < count; k++)
+                where[members[first + k]] = {(int)groups.size(), (int)k};
+            groups.push_back(group);
+        }
+    }
+    return where;
+}
+
+void TextureArrays::setGroups(std::vector<Group> groups)
+{
+    arrays_.clear();
+    for (const auto &group : groups)
+    {
+        Array array;
+        array.group = group;
+        arrays_.push_back(std::move(array));
+    }
+}
+
+size_t TextureArrays::arrayCount() const
+{
+    return (size_t)std::count_if(arrays_.begin(), arrays_.end(), [](const Array &a) { return (bool)a.id; });
+}
+
+void TextureArrays::allocate(Array &array, const DecodedImage &image)
+{
+    array.codec = image.codec;
+    array.levels = image.levels.size();
+    const Group &g = array.group;
+    const GLenum format = pixelFormat(g.channels);
+
+    unsigned tex;
+    glGenTextures(1, &tex);
+    array.id.reset(tex);
+    GlState::instance().bindTexture(0, GL_TEXTURE_2D_ARRAY, tex);
+    for (size_t i = 0; i < array.levels; i++)
+    {
+        const int w = image.levels[i].width, h = image.levels[i].height;
+        if (array.codec == TextureCodec::None)
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, format, w, h, g.layers, 0, format, GL_UNSIGNED_BYTE,
+                         nullptr);
+            bytes_ += (uint64_t)w * h * g.layers * (g.channels <= 2 ? g.channels : 4);
+        }
+        else
+        {
+            const GLenum internal = array.codec == TextureCodec::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                                                     : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            const uint64_t size = blockBytes(array.codec, w, h) * g.layers;
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, internal, w, h, g.layers, 0, (GLsizei)size,
+                                   nullptr);
+            bytes_ += size;
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)array.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+bool TextureArrays::upload(const TextureLayer &where, const DecodedImage &image, UploadRing *ring)
+{
+    if (where.group < 0 || where.group >= (int)arrays_.size() || image.levels.empty())
+        return false;
+    Array &array = arrays_[where.group];
+    const Group &g = array.group;
+    if (image.width != g.width || image.height != g.height || image.channels != g.channels ||
+        where.layer < 0 || where.layer >= g.layers)
+        return false;
+    if (array.id && (image.codec != array.codec || image.levels.size() != array.levels))
+        return false;
+
+    ScopedPhase phase(LoadPhase::GpuUpload, image.path);
+    if (!array.id)
+        allocate(array, image);
+
+    GlState::instance().bindTexture(0, GL_TEXTURE_2D_ARRAY, array.id.get());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const GLenum format = pixelFormat(g.channels);
+    for (size_t i = 0; i < image.levels.size(); i++)
+    {
+        const MipLevel &level = image.levels[i];
+        const void *src = ring ? ring->stage(level.data.data(), level.data.size()) : level.data.data();
+        if (array.codec == TextureCodec::None)
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, where.layer, level.width, level.height, 1, format,
+                            GL_UNSIGNED_BYTE, src);
+        else
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, where.layer, level.width, level.height, 1,
+                                      array.codec == TextureCodec::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                                                       : GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                      (GLsizei)level.data.size(), src);
+    }
+    if (ring)
+        ring->fence();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    phase.addBytes(image.bytes());
+    layers_++;
+    return true;
+}
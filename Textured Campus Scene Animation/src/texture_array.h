@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "gl_handle.h"
+#include "texture_cache.h"
+
+class UploadRing;
+
+// 貼圖在 GL_TEXTURE_2D_ARRAY 中的位置
+struct TextureLayer {
+    int group = -1; // -1 = 不在陣列中
+    int layer = -1;
+};
+
+// 同尺寸、同 channel 數的貼圖打包成 GL_TEXTURE_2D_ARRAY，繪製時以 layer 索引取代換貼圖
+// 陣列在整個 Model 生命週期內常駐，不受 TextureCache 的 VRAM 預算管理
+class TextureArrays {
+public:
+    // GL 3.3 保證 GL_MAX_ARRAY_TEXTURE_LAYERS 至少 256
+    static const int kMaxLayers = 256;
+
+    struct Group {
+        int width = 0, height = 0, channels = 0;
+        int layers = 0;
+    };
+
+    // 只讀取圖檔標頭分組（不碰 GL，可在 worker 呼叫）；回傳每個路徑的位置，單獨一張者不放入陣列
+    // 尺寸以 sizes 縮小後的結果計算，需與解碼時的設定相同
+    static std::vector<TextureLayer> plan(const std::vector<std::string>& paths, std::vector<Group>& groups,
+                                          const TextureSizePolicy& sizes = TextureSizePolicy());
+
+    TextureArrays() = default;
+    TextureArrays(const TextureArrays&) = delete;
+    TextureArrays& operator=(const TextureArrays&) = delete;
+
+    void setGroups(std::vector<Group> groups);
+    // 需在 GL thread 呼叫；第一張決定整組的格式與 mip 層數，之後不相符（如 BC1 / BC3 混用）時回傳 false
+    // ring 不為 nullptr 時各層經由其 PBO 上傳
+    bool upload(const TextureLayer& where, const DecodedImage& image, UploadRing* ring = nullptr);
+
+    unsigned id(int group) const { return group >= 0 && group < (int)arrays_.size() ? arrays_[group].id.get() : 0; }
+    size_t arrayCount() const;
+    size_t layerCount() const { return layers_; }
+    uint64_t residentBytes() const { return bytes_; }
+
+private:
+    struct Array {
+        Group group;
+        GlTexture id;
+        TextureCodec codec = TextureCodec::None;
+        size_t levels = 0;
+    };
+
+    void allocate(Array& array, const DecodedImage& image);
+
+    std::vector<Array> arrays_;
+    size_t layers_ = 0;
+    uint64_t bytes_ = 0;
+};
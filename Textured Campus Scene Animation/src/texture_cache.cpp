@@ -1,54 +1,1036 @@
 #include "texture_cache.h"
+#include "file_util.h"
+#include "gl_state.h"
+#include "load_profiler.h"
+#include "texture_compress.h"
+#include "upload_ring.h"
 #include <OpenGL/gl3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <exception>
+#include <mutex>
 #include <stdexcept>
 #include <iostream>
+#include <thread>
+#include <utility>
+#include <time.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-unsigned TextureCache::getOrLoad2D(const std::string &path)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+DecodedImage::DecodedImage(DecodedImage&& o) noexcept
+    : path(std::move(o.path)), width(o.width), height(o.height), channels(o.channels), pixels(o.pixels),
+      codec(o.codec), levels(std::move(o.levels)), fromCache(o.fromCache)
 {
-    auto it = cache_.find(path);
-    if (it != cache_.end())
-        return it->second;
+    o.pixels = nullptr;
+}
 
-    int width, height, channels;
-    stbi_set_flip_vertically_on_load(true); // OpenGL Y 軸反轉
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 0);
-    if (!data)
-        throw std::runtime_error("Failed to load texture: " + path);
+DecodedImage& DecodedImage::operator=(DecodedImage&& o) noexcept
+{
+    if (this != &o)
+    {
+        releasePixels();
+        path = std::move(o.path);
+        width = o.width;
+        height = o.height;
+        channels = o.channels;
+        pixels = o.pixels;
+        codec = o.codec;
+        levels = std::move(o.levels);
+        fromCache = o.fromCache;
+        o.pixels = nullptr;
+    }
+    return *this;
+}
 
-    GLenum format = GL_RGB;
-    if (channels == 1)
-        format = GL_RED;
-    else if (channels == 3)
-        format = GL_RGB;
-    else if (channels == 4)
-        format = GL_RGBA;
+DecodedImage::~DecodedImage()
+{
+    releasePixels();
+}
 
-    unsigned tex;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+void DecodedImage::releasePixels()
+{
+    if (pixels)
+        stbi_image_free(pixels);
+    pixels = nullptr;
+}
+
+size_t DecodedImage::bytes() const
+{
+    if (levels.empty())
+        return (size_t)width * height * channels;
+    size_t total = 0;
+    for (const auto &level : levels)
+        total += level.data.size();
+    return total;
+}
+
+namespace
+{
+
+// 降級後保留的最大邊長；mip 串流時也是初次上傳的大小
+const int kEvictedSize = 64;
+// mip 串流：最細 level 連續這麼多幀用不到才丟掉
+const uint64_t kTrimFrames = 120;
+// 同時在背景解碼的重新載入數上限（限制暫存的解碼結果）
+const size_t kMaxReloadsInFlight = 2;
 
-    // Filter / wrap 設定
+GLenum pixelFormat(int channels)
+{
+    switch (channels)
+    {
+    case 1:
+        return GL_RED;
+    case 2:
+        return GL_RG;
+    case 4:
+        return GL_RGBA;
+    default:
+        return GL_RGB;
+    }
+}
+
+GLenum internalFormat(TextureCodec codec, int channels)
+{
+    if (codec == TextureCodec::BC1)
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    if (codec == TextureCodec::BC3)
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    return pixelFormat(channels);
+}
+
+// 驅動程式通常把 RGB8 存成 RGBA8
+uint64_t texelBytes(int channels)
+{
+    return channels <= 2 ? (uint64_t)channels : 4;
+}
+
+uint64_t levelGpuBytes(const MipLevel &level, TextureCodec codec, int channels)
+{
+    if (codec != TextureCodec::None)
+        return level.data.size();
+    return (uint64_t)level.width * level.height * texelBytes(channels);
+}
+
+void setSampling()
+{
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
 
-    stbi_image_free(data);
-    cache_[path] = tex;
+// 有 ring 時把資料複製進 PBO，回傳 PBO 內位移；否則回傳用戶端指標
+const void *staged(UploadRing *ring, const void *data, size_t bytes)
+{
+    return ring ? ring->stage(data, bytes) : data;
+}
 
-    std::cout << "Loaded texture: " << path << std::endl;
+// 建立貼圖並逐層上傳預先產生的 mip 鏈；RGB / RED 的列不一定對齊 4 bytes
+// 先配置所有層再以 glTex(Compressed)SubImage2D 由 PBO 上傳，呼叫端不必等複製完成
+unsigned createTexture(const MipLevel *levels, size_t count, TextureCodec codec, int channels, uint64_t &bytes,
+                       UploadRing *ring)
+{
+    const GLenum format = pixelFormat(channels);
+    const GLenum internal = internalFormat(codec, channels);
+    unsigned tex;
+    glGenTextures(1, &tex);
+    GlState::instance().bindTexture(0, GL_TEXTURE_2D, tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    bytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const MipLevel &level = levels[i];
+        if (codec == TextureCodec::None)
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, internal, level.width, level.height, 0, format,
+                         GL_UNSIGNED_BYTE, nullptr);
+        else
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, internal, level.width, level.height, 0,
+                                   (GLsizei)level.data.size(), nullptr);
+        bytes += levelGpuBytes(level, codec, channels);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        const MipLevel &level = levels[i];
+        const void *src = staged(ring, level.data.data(), level.data.size());
+        if (codec == TextureCodec::None)
+            glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height, format, GL_UNSIGNED_BYTE,
+                            src);
+        else
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height, internal,
+                                      (GLsizei)level.data.size(), src);
+    }
+    if (ring)
+        ring->fence();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)count - 1);
+    setSampling();
     return tex;
 }
 
+} // namespace
+
+// 大小 + 開頭、中段、結尾的取樣區塊；只讀取少量資料
+static uint64_t sampledHash(const MappedFile &file)
+{
+    const size_t kBlock = 4096;
+    const size_t size = file.size();
+    uint64_t h = hashBytes(&size, sizeof(size));
+    if (size <= 4 * kBlock)
+        return hashBytes(file.data(), size, h);
+    for (int i = 0; i < 4; i++)
+    {
+        size_t offset = i == 3 ? size - kBlock : (size - kBlock) / 3 * i;
+        h = hashBytes(file.data() + offset, kBlock, h);
+    }
+    return h;
+}
+
+const std::string &TextureDeduplicator::canonical(const std::string &path)
+{
+    auto known = canonical_.find(path);
+    if (known != canonical_.end())
+        return known->second;
+
+    MappedFile file(path);
+    if (!file.valid())
+        return canonical_.emplace(path, path).first->second;
+
+    std::vector<Candidate> &candidates = bySample_[sampledHash(file)];
+    uint64_t fullHash = 0;
+    bool hashed = false;
+    for (auto &candidate : candidates)
+    {
+        // 取樣相同時才計算完整雜湊；候選的雜湊只算一次
+        if (!candidate.hashed)
+        {
+            MappedFile other(candidate.path);
+            if (!other.valid())
+                continue;
+            candidate.fullHash = hashBytes(other.data(), other.size());
+            candidate.hashed = true;
+        }
+        if (!hashed)
+        {
+            fullHash = hashBytes(file.data(), file.size());
+            hashed = true;
+        }
+        if (candidate.fullHash == fullHash)
+        {
+            duplicates_++;
+            duplicateFileBytes_ += file.size();
+            return canonical_.emplace(path, candidate.path).first->second;
+        }
+    }
+
+    Candidate self;
+    self.path = path;
+    self.fullHash = fullHash;
+    self.hashed = hashed;
+    candidates.push_back(std::move(self));
+    return canonical_.emplace(path, path).first->second;
+}
+
+unsigned TextureCache::getOrLoad2D(const std::string &path)
+{
+    auto it = cache_.find(path);
+    if (it != cache_.end())
+        return use(it->second);
+
+    const std::string &original = dedup_.canonical(path);
+    it = cache_.find(original);
+    if (it != cache_.end())
+    {
+        alias(path, it->second);
+        return use(it->second);
+    }
+    return use(upload(decode(path, *reloadOptions_)));
+}
+
+// Opacity / alpha 遮罩貼圖（單 channel 時視為 alpha）
+static bool looksLikeCutout(const std::string &path)
+{
+    std::string name = std::filesystem::path(path).filename().string();
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return name.find("opacity") != std::string::npos || name.find("alpha") != std::string::npos ||
+           name.find("mask") != std::string::npos;
+}
+
+bool TextureSizeLimit::fit(int width, int height, int &outWidth, int &outHeight) const
+{
+    const uint64_t maxTexels = maxBytes / 4;
+    double scale = 1.0;
+    if (maxDimension > 0)
+        scale = std::min(scale, (double)maxDimension / std::max(width, height));
+    if (maxTexels > 0)
+        scale = std::min(scale, std::sqrt((double)maxTexels / ((double)width * height)));
+    if (scale >= 1.0)
+        return false;
+    // 容許浮點誤差後無條件捨去，再逐步縮小直到確實不超過上限
+    outWidth = std::max(1, (int)(width * scale + 1e-6));
+    outHeight = std::max(1, (int)(height * scale + 1e-6));
+    while ((maxDimension > 0 && std::max(outWidth, outHeight) > maxDimension) ||
+           (maxTexels > 0 && (uint64_t)outWidth * outHeight > maxTexels))
+    {
+        if (outWidth == 1 && outHeight == 1)
+            break;
+        if (outWidth * (int64_t)height >= outHeight * (int64_t)width)
+            outWidth = std::max(1, outWidth - 1);
+        else
+            outHeight = std::max(1, outHeight - 1);
+    }
+    return true;
+}
+
+// 目錄與路徑皆轉為正規化的絕對路徑再比對（相對路徑以目前工作目錄為準）
+static std::string normalizedPath(const std::string &path)
+{
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+    return (ec ? std::filesystem::path(path) : absolute).lexically_normal().generic_string();
+}
+
+void TextureSizePolicy::set(const std::string &directory, const TextureSizeLimit &limit)
+{
+    std::string dir = normalizedPath(directory);
+    if (dir.empty() || dir.back() != '/')
+        dir += '/';
+    for (auto &entry : directories_)
+    {
+        if (entry.first == dir)
+        {
+            entry.second = limit;
+            return;
+        }
+    }
+    directories_.emplace_back(dir, limit);
+}
+
+const TextureSizeLimit &TextureSizePolicy::limitFor(const std::string &path) const
+{
+    if (directories_.empty())
+        return default_;
+    const std::string normalized = normalizedPath(path);
+    const TextureSizeLimit *best = &default_;
+    size_t bestLength = 0;
+    for (const auto &entry : directories_)
+    {
+        if (entry.first.size() > bestLength && normalized.compare(0, entry.first.size(), entry.first) == 0)
+        {
+            best = &entry.second;
+            bestLength = entry.first.size();
+        }
+    }
+    return *best;
+}
+
+DecodedImage TextureCache::decode(const std::string &path, const TextureDecodeOptions &options)
+{
+    MipOptions mip = options.mip;
+    mip.singleChannelAlpha = mip.singleChannelAlpha || looksLikeCutout(path);
+    const bool cache = options.cache && options.mipmaps;
+    const TextureSizeLimit &limit = options.sizes.limitFor(path);
+    const uint32_t cacheFlags = mip.key() | (options.compress ? 1u << 16 : 0u);
+
+    DecodedImage image;
+    if (cache)
+    {
+        ScopedPhase phase(LoadPhase::TextureCacheRead, path);
+        if (readTextureCache(path, cacheFlags, limit, image))
+        {
+            phase.addBytes(image.bytes());
+            return image;
+        }
+    }
+
+    {
+        ScopedPhase phase(LoadPhase::TextureDecode, path);
+        image.path = path;
+        stbi_set_flip_vertically_on_load_thread(true); // OpenGL Y 軸反轉（僅影響本執行緒）
+        image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+        if (!image.pixels)
+            throw std::runtime_error("Failed to load texture: " + path);
+        phase.addBytes(image.bytes());
+    }
+
+    // 以 STBI_MALLOC 配置，與解碼結果同樣由 releasePixels 釋放
+    int width, height;
+    if (limit.fit(image.width, image.height, width, height))
+    {
+        ScopedPhase phase(LoadPhase::TextureResize, path);
+        auto *resized = (unsigned char *)STBI_MALLOC((size_t)width * height * image.channels);
+        if (resized && resampleImage(image.pixels, image.width, image.height, image.channels, resized, width,
+                                     height, mip))
+        {
+            std::cout << "Downscaled texture: " << path << " " << image.width << "x" << image.height << " -> "
+                      << width << "x" << height << std::endl;
+            image.releasePixels();
+            image.pixels = resized;
+            image.width = width;
+            image.height = height;
+            phase.addBytes(image.bytes());
+        }
+        else if (resized)
+        {
+            STBI_FREE(resized);
+        }
+    }
+    if (!options.mipmaps)
+        return image;
+
+    {
+        ScopedPhase phase(LoadPhase::Mipmap, path);
+        image.levels = buildMipChain(image.pixels, image.width, image.height, image.channels, mip);
+        image.releasePixels();
+        phase.addBytes(image.bytes());
+    }
+
+    if (options.compress)
+    {
+        ScopedPhase phase(LoadPhase::TextureCompress, path);
+        if (compressImage(image))
+            phase.addBytes(image.bytes());
+    }
+
+    if (cache && !writeTextureCache(path, cacheFlags, limit, image))
+        std::cerr << "Failed to write texture cache: " << textureCachePath(path) << std::endl;
+    return image;
+}
+
+bool TextureCache::compressionSupported()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+            return true;
+    }
+    return false;
+}
+
+int TextureCache::upload(const DecodedImage &image, std::shared_ptr<const TextureDecodeOptions> options)
+{
+    auto it = cache_.find(image.path);
+    if (it != cache_.end())
+    {
+        entries_[it->second].refs++;
+        return it->second;
+    }
+
+    Entry entry;
+    entry.path = image.path;
+    entry.refs = 1;
+    entry.options = options ? std::move(options) : reloadOptions_;
+    entry.codec = image.codec;
+    entry.channels = image.channels;
+    entry.lastUsed = frame_; // 剛上傳的貼圖本幀不會被降級
+
+    // mip 串流時先只上傳小 mip，細 level 等畫面需要時再補
+    int firstLevel = 0;
+    if (streaming_)
+    {
+        while (firstLevel + 1 < (int)image.levels.size() &&
+               std::max(image.levels[firstLevel].width, image.levels[firstLevel].height) > kEvictedSize)
+            firstLevel++;
+    }
+    createFrom(entry, image, firstLevel);
+
+    // 以 RGBA8 + 完整 mip 鏈（約 4/3）估計未壓縮時的 VRAM
+    entry.rawBytes = (uint64_t)image.width * image.height * texelBytes(image.channels) * 4 / 3;
+    stats_.rawBytes += entry.rawBytes;
+    stats_.textures++;
+    stats_.compressed += image.codec != TextureCodec::None ? 1 : 0;
+    stats_.cacheHits += image.fromCache ? 1 : 0;
+    stats_.residentBytes += entry.bytes;
+
+    std::cout << "Loaded texture: " << image.path;
+    if (image.codec != TextureCodec::None)
+        std::cout << (image.codec == TextureCodec::BC3 ? " (BC3)" : " (BC1)");
+    if (image.fromCache)
+        std::cout << " (cached)";
+    std::cout << std::endl;
+
+    int handle;
+    if (!freeHandles_.empty())
+    {
+        handle = freeHandles_.back();
+        freeHandles_.pop_back();
+        entries_[handle] = std::move(entry);
+    }
+    else
+    {
+        handle = (int)entries_.size();
+        entries_.push_back(std::move(entry));
+    }
+    {
+        std::lock_guard<std::mutex> lock(pathsMutex_);
+        cache_[image.path] = handle;
+    }
+    makeRoom(0);
+    return handle;
+}
+
+int TextureCache::acquire(const std::string &path)
+{
+    auto it = cache_.find(path);
+    if (it == cache_.end())
+        return -1;
+    entries_[it->second].refs++;
+    return it->second;
+}
+
+void TextureCache::release(int handle)
+{
+    if (handle < 0 || handle >= (int)entries_.size() || entries_[handle].refs <= 0)
+        return;
+    if (--entries_[handle].refs == 0)
+        freeEntry(handle);
+}
+
+bool TextureCache::contains(const std::string &path) const
+{
+    std::lock_guard<std::mutex> lock(pathsMutex_);
+    return cache_.count(path) != 0;
+}
+
+void TextureCache::freeEntry(int handle)
+{
+    Entry &entry = entries_[handle];
+    {
+        std::lock_guard<std::mutex> lock(pathsMutex_);
+        for (auto it = cache_.begin(); it != cache_.end();)
+        {
+            if (it->second != handle)
+            {
+                ++it;
+                continue;
+            }
+            if (it->first != entry.path)
+            {
+                stats_.aliases--;
+                stats_.aliasedBytes -= entry.fullBytes;
+            }
+            it = cache_.erase(it);
+        }
+    }
+    stats_.residentBytes -= entry.bytes;
+    stats_.rawBytes -= entry.rawBytes;
+    stats_.textures--;
+    stats_.compressed -= entry.codec != TextureCodec::None ? 1 : 0;
+    if (entry.evicted)
+        stats_.evicted--;
+    // 背景解碼中的結果因路徑不符而被 applyReload 捨棄
+    entry = Entry();
+    freeHandles_.push_back(handle);
+}
+
+void TextureCache::createFrom(Entry &entry, const DecodedImage &image, int firstLevel)
+{
+    ScopedPhase phase(LoadPhase::GpuUpload, image.path);
+    entry.tail.clear();
+    entry.tailBytes = 0;
+    entry.levelBytes.clear();
+    entry.size = std::max(image.width, image.height);
+    if (image.levels.empty())
+    {
+        unsigned tex;
+        glGenTextures(1, &tex);
+        GlState::instance().bindTexture(0, GL_TEXTURE_2D, tex);
+        const GLenum format = pixelFormat(image.channels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE,
+                        staged(ring_.get(), image.pixels, image.bytes()));
+        if (ring_)
+            ring_->fence();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        phase.addBytes(image.bytes());
+        {
+            // 完整 mip 鏈約為基底的 1/3
+            ScopedPhase mipPhase(LoadPhase::Mipmap, image.path);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            mipPhase.addBytes(image.bytes() / 3);
+        }
+        setSampling();
+        entry.texture.reset(tex);
+        entry.bytes = (uint64_t)image.width * image.height * texelBytes(image.channels) * 4 / 3;
+        entry.level = entry.tailLevel = 0;
+        entry.levelBytes.push_back(entry.bytes);
+    }
+    else
+    {
+        const int count = (int)image.levels.size();
+        firstLevel = std::clamp(firstLevel, 0, count - 1);
+        entry.texture.reset(createTexture(image.levels.data() + firstLevel, count - firstLevel, image.codec,
+                                          image.channels, entry.bytes, ring_.get()));
+        entry.level = firstLevel;
+
+        entry.levelBytes.resize(count);
+        uint64_t suffix = 0;
+        for (int i = count - 1; i >= 0; i--)
+        {
+            suffix += levelGpuBytes(image.levels[i], image.codec, image.channels);
+            entry.levelBytes[i] = suffix;
+        }
+        uint64_t uploaded = 0;
+        for (int i = firstLevel; i < count; i++)
+            uploaded += image.levels[i].data.size();
+        phase.addBytes(uploaded);
+
+        // 保留尾端小 mip，降級時不需重新解碼
+        entry.tailLevel = count - 1;
+        for (int i = 0; i < count; i++)
+        {
+            const MipLevel &level = image.levels[i];
+            if (std::max(level.width, level.height) > kEvictedSize)
+                continue;
+            if (entry.tail.empty())
+                entry.tailLevel = i;
+            entry.tail.push_back(level);
+            entry.tailBytes += levelGpuBytes(level, image.codec, image.channels);
+        }
+    }
+    entry.fullBytes = entry.levelBytes[0];
+    entry.evicted = false;
+    entry.lastFineUse = frame_;
+    entry.trimLevel = entry.tailLevel;
+}
+
+void TextureCache::requestReload(int handle, int level, bool trim, bool prefetch)
+{
+    Entry &entry = entries_[handle];
+    entry.pending = true;
+    reloadsInFlight_++;
+
+    Reload reload;
+    reload.handle = handle;
+    reload.level = level;
+    reload.trim = trim;
+    reload.prefetch = prefetch;
+    reload.path = entry.path;
+    reload.options = entry.options;
+    {
+        std::lock_guard<std::mutex> lock(reloadMutex_);
+        if (!reloadThread_.joinable())
+            reloadThread_ = std::thread(&TextureCache::reloadLoop, this);
+        reloadRequests_.push_back(std::move(reload));
+    }
+    reloadWake_.notify_one();
+}
+
+void TextureCache::reloadLoop()
+{
+    std::unique_lock<std::mutex> lock(reloadMutex_);
+    for (;;)
+    {
+        reloadWake_.wait(lock, [this] { return reloadStop_ || !reloadRequests_.empty(); });
+        if (reloadStop_)
+            return;
+        Reload reload = std::move(reloadRequests_.front());
+        reloadRequests_.pop_front();
+        lock.unlock();
+        try
+        {
+            reload.image = decode(reload.path, *reload.options);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            reload.failed = true;
+        }
+        lock.lock();
+        reloadResults_.push_back(std::move(reload));
+    }
+}
+
+bool TextureCache::applyReload(Reload &reload)
+{
+    // clear() 之後才完成的結果
+    if (reload.handle >= (int)entries_.size() || entries_[reload.handle].path != reload.path)
+        return false;
+    Entry &entry = entries_[reload.handle];
+    entry.pending = false;
+    if (reload.failed)
+    {
+        entry.reloadFailed = true;
+        return false;
+    }
+
+    // 解碼期間要求可能已改變：結果含完整 mip 鏈，依目前的要求決定上傳哪些 level
+    int level = reload.level;
+    if (reload.trim)
+    {
+        if (entry.evicted || level <= entry.level || entry.lastFineUse + kTrimFrames > frame_)
+            return false;
+    }
+    else
+    {
+        level = std::min(wantedLevel(entry, true), entry.tailLevel);
+        if (level >= entry.level || !makeRoom(entry.levelBytes[level] - entry.bytes))
+            return false;
+    }
+
+    const bool wasEvicted = entry.evicted;
+    entry.texture.reset();
+    stats_.residentBytes -= entry.bytes;
+    createFrom(entry, reload.image, level);
+    stats_.residentBytes += entry.bytes;
+    if (wasEvicted)
+        stats_.evicted--;
+    return true;
+}
+
+int TextureCache::levelFor(const Entry &entry, float uvPerPixel) const
+{
+    if (!streaming_ || uvPerPixel <= 0.0f || entry.levelBytes.size() <= 1)
+        return 0;
+    // 每個像素跨越的 texel 數；level k 每像素約 1 texel 時 texels ≈ 2^k
+    const float texels = uvPerPixel * entry.size;
+    if (texels <= 1.0f)
+        return 0;
+    return std::min((int)std::log2(texels), (int)entry.levelBytes.size() - 1);
+}
+
+int TextureCache::wantedLevel(const Entry &entry, bool withPrefetch) const
+{
+    // frame_ 已在 beginFrame 推進，前一幀的要求仍有效
+    int level = (int)entry.levelBytes.size();
+    if (entry.wantedFrame + 1 >= frame_)
+        level = entry.wanted;
+    if (withPrefetch && entry.prefetchFrame + 1 >= frame_)
+        level = std::min(level, entry.prefetchLevel);
+    return level;
+}
+
+void TextureCache::markSatisfied(Entry &entry, int want)
+{
+    if (want == entry.level)
+    {
+        entry.lastFineUse = frame_;
+        entry.trimLevel = entry.tailLevel;
+    }
+    else
+    {
+        entry.trimLevel = std::min(entry.trimLevel, want);
+    }
+}
+
+void TextureCache::alias(const std::string &path, int handle)
+{
+    if (handle < 0 || handle >= (int)entries_.size() || entries_[handle].refs <= 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(pathsMutex_);
+        if (!cache_.emplace(path, handle).second)
+            return;
+    }
+    stats_.aliases++;
+    stats_.aliasedBytes += entries_[handle].fullBytes;
+}
+
+unsigned TextureCache::use(int handle, float uvPerPixel)
+{
+    if (handle < 0 || handle >= (int)entries_.size() || entries_[handle].refs <= 0)
+        return 0;
+    Entry &entry = entries_[handle];
+    entry.lastUsed = frame_;
+
+    // 同一幀被多個 mesh 使用時取最細的要求
+    const int want = levelFor(entry, uvPerPixel);
+    if (entry.wantedFrame != frame_ || want < entry.wanted)
+    {
+        entry.wanted = want;
+        entry.wantedFrame = frame_;
+    }
+
+    if (want < entry.level)
+    {
+        stats_.misses++;
+        entry.reloadWanted = !entry.reloadFailed;
+    }
+    else
+    {
+        stats_.hits++;
+        markSatisfied(entry, want);
+    }
+    return entry.texture.get();
+}
+
+void TextureCache::prefetch(int handle, float uvPerPixel)
+{
+    if (handle < 0 || handle >= (int)entries_.size() || entries_[handle].refs <= 0)
+        return;
+    Entry &entry = entries_[handle];
+    entry.lastUsed = frame_;
+
+    const int want = levelFor(entry, uvPerPixel);
+    if (entry.prefetchFrame != frame_ || want < entry.prefetchLevel)
+    {
+        entry.prefetchLevel = want;
+        entry.prefetchFrame = frame_;
+    }
+    if (want < entry.level)
+        entry.reloadWanted = !entry.reloadFailed;
+    else
+        markSatisfied(entry, want);
+}
+
+void TextureCache::beginFrame(const void *user)
+{
+    // 本幀第一個使用者推進 frame；其他使用者在同一幀內的呼叫不重複處理
+    if (std::find(frameUsers_.begin(), frameUsers_.end(), user) != frameUsers_.end())
+        frameUsers_.clear();
+    frameUsers_.push_back(user);
+    if (frameUsers_.size() > 1)
+        return;
+    frame_++;
+
+    // 每幀最多上傳一張解碼完成的貼圖，避免卡頓；已不需要的結果直接捨棄
+    bool applied = false;
+    while (!applied)
+    {
+        Reload reload;
+        {
+            std::lock_guard<std::mutex> lock(reloadMutex_);
+            if (reloadResults_.empty())
+                break;
+            reload = std::move(reloadResults_.front());
+            reloadResults_.pop_front();
+        }
+        reloadsInFlight_--;
+        if (!applyReload(reload))
+            continue;
+        applied = true;
+        if (reload.trim)
+            stats_.trims++;
+        else
+            stats_.reloads++;
+    }
+
+    // 先排入畫面上需要的，再排入預測需要的；預算不足時維持降級，之後再使用時重試
+    bool requested = false;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const bool prefetch = pass == 1;
+        for (size_t i = 0; i < entries_.size() && reloadsInFlight_ < kMaxReloadsInFlight; i++)
+        {
+            Entry &entry = entries_[i];
+            if (!entry.reloadWanted || entry.pending)
+                continue;
+            const int target = std::min(wantedLevel(entry, prefetch), entry.tailLevel);
+            if (target >= entry.level)
+            {
+                if (prefetch)
+                    entry.reloadWanted = false;
+                continue;
+            }
+            entry.reloadWanted = false;
+            if (!makeRoom(entry.levelBytes[target] - entry.bytes))
+                continue;
+            requestReload((int)i, target, false, prefetch);
+            stats_.prefetches += prefetch ? 1 : 0;
+            requested = true;
+        }
+    }
+
+    // 沒有要補的貼圖且接近預算時，把最細 level 久未用到的貼圖降到近期需要的 level（省最多者優先）
+    if (!requested && reloadsInFlight_ == 0 && streaming_ && stats_.budgetBytes > 0 &&
+        stats_.residentBytes > stats_.budgetBytes / 4 * 3)
+    {
+        int victim = -1;
+        uint64_t saved = 0;
+        for (size_t i = 0; i < entries_.size(); i++)
+        {
+            const Entry &entry = entries_[i];
+            if (entry.evicted || entry.reloadFailed || entry.pending || entry.trimLevel <= entry.level ||
+                entry.lastFineUse + kTrimFrames > frame_)
+                continue;
+            const uint64_t bytes = entry.bytes - entry.levelBytes[entry.trimLevel];
+            if (bytes > saved)
+            {
+                saved = bytes;
+                victim = (int)i;
+            }
+        }
+        if (victim >= 0)
+            requestReload(victim, entries_[victim].trimLevel, true, false);
+    }
+    makeRoom(0);
+}
+
+void TextureCache::setBudget(uint64_t bytes)
+{
+    stats_.budgetBytes = bytes;
+    makeRoom(0);
+}
+
+bool TextureCache::makeRoom(uint64_t incoming)
+{
+    if (stats_.budgetBytes == 0)
+        return true;
+    while (stats_.residentBytes + incoming > stats_.budgetBytes)
+    {
+        Entry *victim = nullptr;
+        for (auto &entry : entries_)
+        {
+            // 本幀與前一幀用到的貼圖仍在畫面上，降級只會造成反覆重新載入
+            if (entry.evicted || entry.lastUsed + 1 >= frame_ || entry.bytes <= entry.tailBytes)
+                continue;
+            if (!victim || entry.lastUsed < victim->lastUsed)
+                victim = &entry;
+        }
+        if (!victim)
+            return false;
+        evict(*victim);
+    }
+    return true;
+}
+
+void TextureCache::evict(Entry &entry)
+{
+    entry.texture.reset();
+    stats_.residentBytes -= entry.bytes;
+    entry.bytes = 0;
+    if (!entry.tail.empty())
+    {
+        entry.texture.reset(createTexture(entry.tail.data(), entry.tail.size(), entry.codec, entry.channels,
+                                          entry.bytes, ring_.get()));
+        stats_.residentBytes += entry.bytes;
+    }
+    // 沒有 tail 時視為所有 level 都不在 GPU 上
+    entry.level = entry.tail.empty() ? (int)entry.levelBytes.size() : entry.tailLevel;
+    entry.evicted = true;
+    stats_.evictions++;
+    stats_.evicted++;
+}
+
+// 目前執行緒的 CPU 時間；執行緒數超過核心數時仍能反映實際解碼成本
+static int64_t threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void TextureCache::decodeParallel(const std::vector<std::string> &paths,
+                                  const std::function<void(DecodedImage &&)> &onDecoded,
+                                  const TextureDecodeOptions &options, unsigned threads,
+                                  const std::atomic<bool> *cancel)
+{
+    if (paths.empty())
+        return;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::min<size_t>(threads, paths.size());
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::atomic<int64_t> decodeNs{0}; // 各張解碼的 CPU 時間總和（≈ 單執行緒基準）
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto work = [&]() {
+        for (;;)
+        {
+            size_t i = next++;
+            if (i >= paths.size() || (cancel && *cancel))
+                return;
+            try
+            {
+                int64_t t0 = threadCpuNs();
+                DecodedImage image = decode(paths[i], options);
+                decodeNs += threadCpuNs() - t0;
+                onDecoded(std::move(image));
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                    error = std::current_exception();
+                next = paths.size(); // 其餘不再解碼
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(work);
+    work();
+    for (auto &t : workers)
+        t.join();
+
+    if (error)
+        std::rethrow_exception(error);
+
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double serialMs = decodeNs / 1e6;
+    std::cout << "Decoded " << paths.size() << " textures on " << threads << " threads: "
+              << wallMs << " ms wall, " << serialMs << " ms serial (x"
+              << (wallMs > 0.0 ? serialMs / wallMs : 0.0) << ")" << std::endl;
+}
+
+TextureCache::~TextureCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(reloadMutex_);
+        reloadStop_ = true;
+    }
+    reloadWake_.notify_all();
+    if (reloadThread_.joinable())
+        reloadThread_.join();
+}
+
 void TextureCache::clear()
 {
-    for (auto &[path, id] : cache_)
     {
-        glDeleteTextures(1, &id);
+        // 解碼中的一筆完成後由 applyReload 依路徑捨棄
+        std::lock_guard<std::mutex> lock(reloadMutex_);
+        reloadsInFlight_ -= reloadRequests_.size() + reloadResults_.size();
+        reloadRequests_.clear();
+        reloadResults_.clear();
+    }
+    entries_.clear();
+    freeHandles_.clear();
+    {
+        std::lock_guard<std::mutex> lock(pathsMutex_);
+        cache_.clear();
+    }
+    stats_.textures = 0;
+    stats_.compressed = 0;
+    stats_.aliases = 0;
+    stats_.aliasedBytes = 0;
+    stats_.rawBytes = 0;
+    stats_.residentBytes = 0;
+    stats_.evicted = 0;
+}
+
+std::vector<TextureResourceInfo> TextureCache::resources() const
+{
+    std::vector<TextureResourceInfo> out;
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        const Entry &entry = entries_[i];
+        if (entry.refs <= 0)
+            continue;
+        TextureResourceInfo info;
+        info.path = entry.path;
+        info.handle = (int)i;
+        info.refs = entry.refs;
+        info.bytes = entry.bytes;
+        info.evicted = entry.evicted;
+        out.push_back(std::move(info));
     }
-    cache_.clear();
+    return out;
 }
@@ -1,12 +1,282 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+#include "gl_handle.h"
+#include "mip_chain.h"
 
-// 管理貼圖載入與快取
+class UploadRing;
+
+// GPU 貼圖編碼
+enum class TextureCodec : uint32_t {
+    None = 0, // 未壓縮（RED / RGB / RGBA8）
+    BC1 = 1,  // DXT1，RGB，每 4x4 區塊 8 bytes
+    BC3 = 2,  // DXT5，RGBA，每 4x4 區塊 16 bytes
+};
+
+// CPU 端解碼後的影像（可在 worker thread 產生）
+struct DecodedImage {
+    std::string path;
+    int width = 0, height = 0, channels = 0;
+    unsigned char* pixels = nullptr; // stb 解碼結果，產生 mip 鏈後釋放
+
+    TextureCodec codec = TextureCodec::None;
+    std::vector<MipLevel> levels; // 完整 mip 鏈（未壓縮時每層 channels bytes / texel）
+    bool fromCache = false;       // 由 .texcache 讀入，未經解碼
+
+    DecodedImage() = default;
+    DecodedImage(DecodedImage&& o) noexcept;
+    DecodedImage& operator=(DecodedImage&& o) noexcept;
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator=(const DecodedImage&) = delete;
+    ~DecodedImage();
+
+    void releasePixels();
+    size_t bytes() const;
+};
+
+// 貼圖大小上限；設定值原樣寫入 .texcache 標頭
+struct TextureSizeLimit {
+    int maxDimension = 0;  // 最大邊長，0 = 不限
+    uint64_t maxBytes = 0; // level 0 以 RGBA8 計的大小上限，0 = 不限
+
+    // 依上限計算縮小後的尺寸（維持長寬比）；不需縮小時回傳 false
+    bool fit(int width, int height, int& outWidth, int& outHeight) const;
+};
+
+// 依資產目錄套用的大小上限：以最長的目錄前綴比對，沒有符合者使用預設值
+class TextureSizePolicy {
+public:
+    void setDefault(const TextureSizeLimit& limit) { default_ = limit; }
+    void set(const std::string& directory, const TextureSizeLimit& limit);
+    const TextureSizeLimit& limitFor(const std::string& path) const;
+
+private:
+    TextureSizeLimit default_;
+    std::vector<std::pair<std::string, TextureSizeLimit>> directories_; // 正規化的絕對路徑，以 '/' 結尾
+};
+
+struct TextureDecodeOptions {
+    bool mipmaps = true;   // 在 CPU 產生 mip 鏈；false 時上傳後以 glGenerateMipmap 產生
+    bool compress = false; // 壓縮為 BC1 / BC3（需 mipmaps）
+    bool cache = true;     // 讀寫 <貼圖>.texcache（需 mipmaps）
+    MipOptions mip;
+    TextureSizePolicy sizes; // 超過上限的貼圖在解碼後立即縮小，再產生 mip 鏈
+};
+
+// 已上傳貼圖的 VRAM 統計
+struct TextureStats {
+    size_t textures = 0;
+    size_t compressed = 0;
+    size_t cacheHits = 0;     // 由 .texcache 載入（未經解碼）
+    size_t aliases = 0;       // 因內容相同而共用貼圖的路徑數
+    uint64_t aliasedBytes = 0; // 共用省下的 VRAM
+    uint64_t rawBytes = 0;    // 以 RGBA8 + 完整 mip 鏈上傳時的估計
+    uint64_t residentBytes = 0; // 目前 GPU 佔用（含 mip）
+    uint64_t budgetBytes = 0;   // 0 = 不限
+
+    // 每次 use() 計一次：完整解析度為 hit，已降級為 miss（並排入重新載入）
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t reloads = 0;
+    size_t evicted = 0; // 目前降級中的貼圖數
+    size_t trims = 0;   // mip 串流：長時間不需要而丟掉細 level 的次數
+    size_t prefetches = 0; // 因 prefetch() 預測而提早開始的重新載入
+};
+
+// 單張貼圖的參考數與 GPU 佔用（除錯用）
+struct TextureResourceInfo {
+    std::string path;
+    int handle = -1;
+    int refs = 0;
+    uint64_t bytes = 0;
+    bool evicted = false;
+};
+
+// 依檔案內容辨識不同路徑下的相同貼圖：先比對大小 + 取樣區塊雜湊，相同時再比對完整內容雜湊
+// 不碰 GL，單一執行緒使用
+class TextureDeduplicator {
+public:
+    // 回傳與 path 內容相同且先前登記過的路徑；沒有時登記 path 並回傳 path
+    // 無法讀取的檔案不參與比對（之後由解碼回報錯誤）
+    const std::string& canonical(const std::string& path);
+
+    size_t duplicates() const { return duplicates_; }
+    uint64_t duplicateFileBytes() const { return duplicateFileBytes_; }
+
+private:
+    struct Candidate {
+        std::string path;
+        uint64_t fullHash = 0;
+        bool hashed = false;
+    };
+
+    std::unordered_map<uint64_t, std::vector<Candidate>> bySample_; // 取樣雜湊 -> 候選
+    std::unordered_map<std::string, std::string> canonical_;          // path -> 代表路徑
+    size_t duplicates_ = 0;
+    uint64_t duplicateFileBytes_ = 0;
+};
+
+// 管理貼圖載入與快取；超過 VRAM 預算時依 LRU 降級為小 mip（或灰色佔位），再次使用時重新載入
+// 開啟 mip 串流時只常駐畫面所需的 level：先上傳小 mip，依 use() 要求的解析度逐幀補上細 level
+// 重新載入在背景執行緒解碼，完成後由 beginFrame 上傳
+// 可由多個 Model 共用（見 ResourceManager）：每張貼圖有參考數，最後一個參考釋放時刪除
 class TextureCache {
 public:
+    TextureCache() = default;
+    ~TextureCache();
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // 內容與已載入貼圖相同時共用同一張 GL 貼圖；由 cache 本身持有參考，直到 clear()
     unsigned getOrLoad2D(const std::string& path);
+    // 刪除所有貼圖（不論參考數），既有 handle 全部失效
     void clear();
+
+    // 解碼不碰 GL，可在任意執行緒呼叫；失敗時拋出例外
+    static DecodedImage decode(const std::string& path,
+                               const TextureDecodeOptions& options = TextureDecodeOptions());
+    // 需在 GL thread 呼叫；回傳 handle 並增加一個參考，同一路徑重複上傳時回傳既有 handle
+    // options 為之後重新載入此貼圖的解碼選項（nullptr = setReloadOptions 的設定）
+    int upload(const DecodedImage& image, std::shared_ptr<const TextureDecodeOptions> options = nullptr);
+    // 讓內容相同的另一個路徑共用 handle（計入 aliases / aliasedBytes）
+    void alias(const std::string& path, int handle);
+    // 已上傳的 path（或其別名）增加一個參考並回傳 handle；不存在時回傳 -1
+    int acquire(const std::string& path);
+    // 減少一個參考；歸零時刪除 GL 貼圖與所有別名，handle 之後可能被重複使用
+    void release(int handle);
+    // path 目前是否已上傳；可在任意執行緒呼叫（結果只是提示，acquire 仍可能失敗）
+    bool contains(const std::string& path) const;
+
+    // 取得 handle 目前的 GL 貼圖並更新最近使用的 frame；0 = 無（以佔位貼圖繪製）
+    // uvPerPixel 為螢幕上每個像素跨越的 UV 距離（mip 串流據以決定所需 level）；0 = 需要完整解析度
+    unsigned use(int handle, float uvPerPixel = 0.0f);
+    // 預計之後會以 uvPerPixel 使用 handle（如沿鏡頭路徑預測）：提早排入所需 level 的重新載入，
+    // 並視同本幀使用以免被 LRU 降級；不計入 hits / misses
+    void prefetch(int handle, float uvPerPixel = 0.0f);
+    // 每幀開始時呼叫：推進 frame、上傳最多一張已在背景解碼完成的貼圖，
+    // 再為被使用（畫面所需優先，其次為預測所需）的降級貼圖排入背景解碼，並維持預算
+    // 沒有需要補上的貼圖且 VRAM 吃緊時，改為丟掉一張長時間用不到的細 level
+    // 多個使用者共用時各自以 user 呼叫：同一 user 再次呼叫才推進 frame，其餘視為同一幀
+    void beginFrame(const void* user = nullptr);
+
+    void setBudget(uint64_t bytes);
+    // upload 未指定時重新載入使用的解碼選項（應與初次載入相同，通常會命中 .texcache）
+    void setReloadOptions(const TextureDecodeOptions& options)
+    {
+        reloadOptions_ = std::make_shared<TextureDecodeOptions>(options);
+    }
+    // 上傳改經由 ring 的 PBO（nullptr = 直接由用戶端記憶體上傳）
+    void setUploadRing(std::shared_ptr<UploadRing> ring) { ring_ = std::move(ring); }
+    UploadRing* uploadRing() const { return ring_.get(); }
+    // mip 串流需重新解碼（通常命中 .texcache），只對有 CPU mip 鏈的貼圖生效
+    void setStreaming(bool enabled) { streaming_ = enabled; }
+    bool streaming() const { return streaming_; }
+
+    // 以 threads 條執行緒解碼（0 = hardware_concurrency），每張完成時在解碼執行緒上呼叫 onDecoded
+    // 任一張失敗時在全部結束後拋出第一個例外；cancel 設為 true 時不再開始新的解碼
+    static void decodeParallel(const std::vector<std::string>& paths,
+                               const std::function<void(DecodedImage&&)>& onDecoded,
+                               const TextureDecodeOptions& options = TextureDecodeOptions(),
+                               unsigned threads = 0, const std::atomic<bool>* cancel = nullptr);
+
+    // 目前 context 是否支援 S3TC（需在 GL thread 呼叫）
+    static bool compressionSupported();
+
+    const TextureStats& stats() const { return stats_; }
+    // 目前所有貼圖的參考數與佔用
+    std::vector<TextureResourceInfo> resources() const;
+
 private:
-    std::unordered_map<std::string, unsigned> cache_;
+    struct Entry {
+        std::string path; // 空字串 = 已釋放的 handle
+        GlTexture texture;
+        int refs = 0;
+        std::shared_ptr<const TextureDecodeOptions> options; // 重新載入用
+        uint64_t rawBytes = 0;  // 計入 stats_.rawBytes 的估計
+        uint64_t bytes = 0;     // 目前 GPU 佔用
+        uint64_t fullBytes = 0; // 完整解析度時的佔用
+        uint64_t lastUsed = 0;  // 最近使用的 frame
+        bool evicted = false;
+        bool reloadWanted = false;
+        bool reloadFailed = false;
+        TextureCodec codec = TextureCodec::None;
+        int channels = 0;
+        std::vector<MipLevel> tail; // 邊長不超過 kEvictedSize 的 mip，降級時據以重建
+        uint64_t tailBytes = 0;
+
+        // mip 串流：GPU 上的貼圖由原始 mip 鏈的 level 起算
+        int size = 0;      // level 0 的最大邊長
+        int level = 0;     // 目前常駐的最細 level
+        int tailLevel = 0; // tail[0] 的 level
+        std::vector<uint64_t> levelBytes; // 由各 level 起算到最後一層的 GPU 佔用
+        int wanted = 0;              // 本幀要求的最細 level
+        uint64_t wantedFrame = 0;
+        uint64_t lastFineUse = 0;    // 最近一次需要目前最細 level 的 frame
+        int trimLevel = 0;           // lastFineUse 之後要求過的最細 level，細 level 久未使用時丟到這層
+        int prefetchLevel = 0;       // prefetch() 本幀要求的最細 level
+        uint64_t prefetchFrame = 0;
+        bool pending = false;        // 背景解碼中
+    };
+
+    // 背景解碼的要求與結果
+    struct Reload {
+        int handle = -1;
+        int level = 0;
+        bool trim = false; // 丟掉細 level（結果較目前粗）
+        bool prefetch = false;
+        std::string path;
+        std::shared_ptr<const TextureDecodeOptions> options;
+        DecodedImage image;
+        bool failed = false;
+    };
+
+    // 上傳 image 中 firstLevel 以後的 level
+    void createFrom(Entry& entry, const DecodedImage& image, int firstLevel = 0);
+    // 排入背景解碼，完成後改為常駐 level 以後的 mip
+    void requestReload(int handle, int level, bool trim, bool prefetch);
+    // 上傳一筆解碼結果；已不需要或預算不足時捨棄並回傳 false，解碼失敗時標記 reloadFailed
+    bool applyReload(Reload& reload);
+    void reloadLoop();
+    void evict(Entry& entry);
+    // 刪除 entry 的 GL 貼圖與別名，handle 放回 freeHandles_
+    void freeEntry(int handle);
+    int levelFor(const Entry& entry, float uvPerPixel) const;
+    // 記錄 want 已由常駐的 level 滿足：要求目前最細 level 時延後 trim
+    void markSatisfied(Entry& entry, int want);
+    // use() / prefetch() 近一幀要求的最細 level，沒有要求時為 levelBytes.size()
+    int wantedLevel(const Entry& entry, bool withPrefetch) const;
+    // 降級最久未用、且前一幀以後未使用的貼圖，直到 residentBytes + incoming 不超過預算
+    bool makeRoom(uint64_t incoming);
+
+    std::vector<Entry> entries_;
+    std::vector<int> freeHandles_;
+    std::unordered_map<std::string, int> cache_; // path -> handle；GL thread 修改時持有 pathsMutex_
+    mutable std::mutex pathsMutex_;
+    TextureDeduplicator dedup_;
+    std::shared_ptr<const TextureDecodeOptions> reloadOptions_ = std::make_shared<TextureDecodeOptions>();
+    std::shared_ptr<UploadRing> ring_;
+    bool streaming_ = false;
+    uint64_t frame_ = 1;
+    std::vector<const void*> frameUsers_; // 本幀已呼叫 beginFrame 的使用者
+    TextureStats stats_;
+
+    std::thread reloadThread_; // 第一次重新載入時啟動
+    std::mutex reloadMutex_;
+    std::condition_variable reloadWake_;
+    std::deque<Reload> reloadRequests_;
+    std::deque<Reload> reloadResults_;
+    bool reloadStop_ = false;
+    size_t reloadsInFlight_ = 0; // 已排入但尚未 apply 的數量
 };
@@ -0,0 +1,379 @@
+#include "texture_compress.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 單一 mip 層展開為 RGBA8
+std::vector<uint8_t> toRgba(const MipLevel& level, int channels)
+{
+    const size_t count = (size_t)level.width * level.height;
+    std::vector<uint8_t> rgba(count * 4);
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t* src = &level.data[i * channels];
+        rgba[i * 4 + 0] = src[0];
+        rgba[i * 4 + 1] = src[1];
+        rgba[i * 4 + 2] = src[2];
+        rgba[i * 4 + 3] = channels == 4 ? src[3] : 255;
+    }
+    return rgba;
+}
+
+// ---- BC1 色彩區塊 ----
+uint16_t to565(const float c[3])
+{
+    int r = std::clamp((int)std::lround(c[0] * 31.f / 255.f), 0, 31);
+    int g = std::clamp((int)std::lround(c[1] * 63.f / 255.f), 0, 63);
+    int b = std::clamp((int)std::lround(c[2] * 31.f / 255.f), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void from565(uint16_t v, int out[3])
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// 以主成分方向的投影極值作為端點（內縮 1/16），再逐像素找最近的調色盤色
+void encodeColorBlock(const uint8_t block[16][4], uint8_t out[8])
+{
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += block[i][c] / 16.f;
+
+    float cov[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[3] = {block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2]};
+        cov[0] += d[0] * d[0];
+        cov[1] += d[0] * d[1];
+        cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1];
+        cov[4] += d[1] * d[2];
+        cov[5] += d[2] * d[2];
+    }
+
+    // power iteration 求主軸
+    float axis[3] = {1.f, 1.f, 1.f};
+    for (int it = 0; it < 4; it++)
+    {
+        float n[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                      cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                      cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        float len = std::max(std::fabs(n[0]), std::max(std::fabs(n[1]), std::fabs(n[2])));
+        if (len < 1e-6f)
+            break;
+        for (int c = 0; c < 3; c++)
+            axis[c] = n[c] / len;
+    }
+
+    float lo = 1e30f, hi = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] +
+                  (block[i][2] - mean[2]) * axis[2];
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    float axisLen2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float inset = (hi - lo) / 16.f;
+    float c0f[3], c1f[3];
+    for (int c = 0; c < 3; c++)
+    {
+        c0f[c] = mean[c] + axis[c] * (hi - inset) / std::max(axisLen2, 1e-6f);
+        c1f[c] = mean[c] + axis[c] * (lo + inset) / std::max(axisLen2, 1e-6f);
+    }
+
+    uint16_t c0 = to565(c0f), c1 = to565(c1f);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        // 四色模式（c0 > c1）：0 = c0、1 = c1、2 = 2/3 c0 + 1/3 c1、3 = 1/3 c0 + 2/3 c1
+        int palette[4][3];
+        from565(c0, palette[0]);
+        from565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDist = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1],
+                    db = block[i][2] - palette[p][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+
+    out[0] = (uint8_t)(c0 & 0xff);
+    out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)(c1 & 0xff);
+    out[3] = (uint8_t)(c1 >> 8);
+    std::memcpy(out + 4, &indices, 4); // little endian
+}
+
+// ---- BC3 alpha 區塊（八階模式）----
+void encodeAlphaBlock(const uint8_t block[16][4], uint8_t out[8])
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, (int)block[i][3]);
+        a1 = std::min(a1, (int)block[i][3]);
+    }
+
+    uint64_t bits = 0;
+    if (a0 != a1)
+    {
+        int palette[8] = {a0, a1};
+        for (int k = 1; k < 7; k++)
+            palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDist = 1 << 30;
+            for (int p = 0; p < 8; p++)
+            {
+                int dist = std::abs(block[i][3] - palette[p]);
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            bits |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    for (int k = 0; k < 6; k++)
+        out[2 + k] = (uint8_t)(bits >> (8 * k));
+}
+
+MipLevel encodeLevel(const std::vector<uint8_t>& rgba, int w, int h, TextureCodec codec)
+{
+    const int blockBytes = codec == TextureCodec::BC3 ? 16 : 8;
+    const int bw = (w + 3) / 4, bh = (h + 3) / 4;
+    MipLevel level;
+    level.width = w;
+    level.height = h;
+    level.data.resize((size_t)bw * bh * blockBytes);
+
+    uint8_t block[16][4];
+    for (int by = 0; by < bh; by++)
+    {
+        for (int bx = 0; bx < bw; bx++)
+        {
+            // 邊緣不足 4x4 時重複最後一列 / 行
+            for (int i = 0; i < 16; i++)
+            {
+                int x = std::min(bx * 4 + (i & 3), w - 1);
+                int y = std::min(by * 4 + (i >> 2), h - 1);
+                std::memcpy(block[i], &rgba[((size_t)y * w + x) * 4], 4);
+            }
+            uint8_t* out = &level.data[((size_t)by * bw + bx) * blockBytes];
+            if (codec == TextureCodec::BC3)
+            {
+                encodeAlphaBlock(block, out);
+                out += 8;
+            }
+            encodeColorBlock(block, out);
+        }
+    }
+    return level;
+}
+
+// ---- 磁碟快取 ----
+const char kMagic[8] = {'T', 'E', 'X', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t kVersion = 3;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t codec;
+    uint32_t flags;
+    int32_t maxDimension; // TextureSizeLimit
+    uint64_t maxBytes;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+    int32_t width, height, channels;
+    uint32_t levelCount;
+};
+
+struct LevelRecord {
+    int32_t width, height;
+    uint64_t size;
+};
+
+uint64_t levelBytes(TextureCodec codec, int width, int height, int channels)
+{
+    if (codec == TextureCodec::None)
+        return (uint64_t)width * height * channels;
+    const uint64_t blocks = (uint64_t)((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * (codec == TextureCodec::BC3 ? 16 : 8);
+}
+
+bool sourceKey(const std::string& path, uint64_t& size, int64_t& mtime, uint64_t& hash)
+{
+    if (!fileStamp(path, size, mtime))
+        return false;
+    MappedFile file(path);
+    if (!file.valid())
+        return false;
+    hash = hashBytes(file.data(), file.size());
+    return true;
+}
+
+} // namespace
+
+bool compressImage(DecodedImage& image)
+{
+    if (image.codec != TextureCodec::None || image.levels.empty() ||
+        (image.channels != 3 && image.channels != 4))
+        return false;
+
+    bool alpha = false;
+    if (image.channels == 4)
+    {
+        const std::vector<uint8_t>& base = image.levels[0].data;
+        for (size_t i = 3; i < base.size() && !alpha; i += 4)
+            alpha = base[i] != 255;
+    }
+    const TextureCodec codec = alpha ? TextureCodec::BC3 : TextureCodec::BC1;
+
+    std::vector<MipLevel> levels;
+    levels.reserve(image.levels.size());
+    for (const auto& level : image.levels)
+        levels.push_back(encodeLevel(toRgba(level, image.channels), level.width, level.height, codec));
+
+    image.codec = codec;
+    image.levels = std::move(levels);
+    return true;
+}
+
+std::string textureCachePath(const std::string& sourcePath)
+{
+    return sourcePath + ".texcache";
+}
+
+bool readTextureCache(const std::string& sourcePath, uint32_t flags, const TextureSizeLimit& limit,
+                      DecodedImage& image)
+{
+    MappedFile file(textureCachePath(sourcePath));
+    if (!file.valid() || file.size() < sizeof(CacheHeader))
+        return false;
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.flags != flags || header.maxDimension != limit.maxDimension ||
+        header.maxBytes != limit.maxBytes || header.codec > (uint32_t)TextureCodec::BC3 || header.levelCount == 0)
+        return false;
+
+    uint64_t size;
+    int64_t mtime;
+    uint64_t hash;
+    if (!sourceKey(sourcePath, size, mtime, hash) || size != header.sourceSize ||
+        mtime != header.sourceMtime || hash != header.sourceHash)
+        return false;
+
+    std::vector<MipLevel> levels(header.levelCount);
+    size_t offset = sizeof(CacheHeader);
+    for (auto& level : levels)
+    {
+        LevelRecord record;
+        if (offset + sizeof(record) > file.size())
+            return false;
+        std::memcpy(&record, file.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        if (record.width <= 0 || record.height <= 0 || record.size > file.size() - offset ||
+            record.size != levelBytes((TextureCodec)header.codec, record.width, record.height, header.channels))
+            return false;
+        level.width = record.width;
+        level.height = record.height;
+        level.data.assign(file.data() + offset, file.data() + offset + record.size);
+        offset += record.size;
+    }
+
+    image.path = sourcePath;
+    image.width = header.width;
+    image.height = header.height;
+    image.channels = header.channels;
+    image.codec = (TextureCodec)header.codec;
+    image.levels = std::move(levels);
+    image.fromCache = true;
+    return true;
+}
+
+bool writeTextureCache(const std::string& sourcePath, uint32_t flags, const TextureSizeLimit& limit,
+                       const DecodedImage& image)
+{
+    if (image.levels.empty())
+        return false;
+
+    CacheHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.codec = (uint32_t)image.codec;
+    header.flags = flags;
+    header.maxDimension = limit.maxDimension;
+    header.maxBytes = limit.maxBytes;
+    if (!sourceKey(sourcePath, header.sourceSize, header.sourceMtime, header.sourceHash))
+        return false;
+    header.width = image.width;
+    header.height = image.height;
+    header.channels = image.channels;
+    header.levelCount = (uint32_t)image.levels.size();
+
+    // 先寫入暫存檔再改名，避免其他執行緒 / 程序讀到寫一半的檔案
+    std::string cachePath = textureCachePath(sourcePath);
+    std::string tmpPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& level : image.levels)
+        {
+            LevelRecord record{level.width, level.height, level.data.size()};
+            out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            out.write(reinterpret_cast<const char*>(level.data.data()), (std::streamsize)level.data.size());
+        }
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, cachePath, ec);
+    if (ec)
+    {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "texture_cache.h"
+
+// CPU 端 BC1 / BC3（S3TC / DXT1 / DXT5）壓縮與貼圖磁碟快取
+// BC7 編碼器成本過高，目前未實作
+
+// 壓縮 image.levels 中的未壓縮 mip 鏈：有非 255 alpha 時用 BC3，否則 BC1
+// 只處理 3 / 4 channel 影像；成功時改寫 levels / codec 並回傳 true
+bool compressImage(DecodedImage& image);
+
+// 快取存放於 <貼圖>.texcache，內容為完整 mip 鏈（未壓縮或 BC1 / BC3）
+// 以來源檔大小、修改時間、內容雜湊、flags 與大小上限（產生時的選項）為鍵
+std::string textureCachePath(const std::string& sourcePath);
+bool readTextureCache(const std::string& sourcePath, uint32_t flags, const TextureSizeLimit& limit,
+                      DecodedImage& image);
+bool writeTextureCache(const std::string& sourcePath, uint32_t flags, const TextureSizeLimit& limit,
+                       const DecodedImage& image);
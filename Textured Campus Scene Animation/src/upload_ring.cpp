@@ -0,0 +1,151 @@
+#include "upload_ring.h"
+#include "gl_state.h"
+#include <OpenGL/gl3.h>
+#include <cstring>
+
+namespace
+{
+
+// 各區段起點對齊，避免驅動程式為未對齊的 DMA 來源另做複製
+const size_t kAlignment = 256;
+
+size_t alignUp(size_t v)
+{
+    return (v + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+} // namespace
+
+UploadRing::UploadRing(size_t capacity) : capacity_(alignUp(capacity))
+{
+    unsigned pbo;
+    glGenBuffers(1, &pbo);
+    pbo_.reset(pbo);
+    GlState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity_, nullptr, GL_STREAM_DRAW);
+    GlState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+UploadRing::~UploadRing()
+{
+    // 同一批的區段共用 fence，只刪除一次
+    void *last = nullptr;
+    for (auto &region : regions_)
+    {
+        if (region.sync && region.sync != last)
+            glDeleteSync((GLsync)region.sync);
+        last = region.sync;
+    }
+}
+
+void UploadRing::bind(bool on)
+{
+    GlState::instance().bindBuffer(GL_PIXEL_UNPACK_BUFFER, on ? pbo_.get() : 0);
+}
+
+void UploadRing::retire()
+{
+    while (!regions_.empty() && regions_.front().sync)
+    {
+        void *sync = regions_.front().sync;
+        GLenum status = glClientWaitSync((GLsync)sync, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync((GLsync)sync);
+        while (!regions_.empty() && regions_.front().sync == sync)
+            regions_.pop_front();
+    }
+    if (regions_.empty())
+        head_ = 0;
+}
+
+bool UploadRing::allocate(size_t bytes, size_t &offset)
+{
+    retire();
+    bytes = alignUp(bytes);
+    if (bytes > capacity_)
+        return false;
+
+    if (regions_.empty())
+    {
+        offset = 0;
+    }
+    else
+    {
+        // 使用中的範圍為 [tail, head_)，可能環繞
+        const size_t tail = regions_.front().begin;
+        if (head_ > tail)
+        {
+            if (capacity_ - head_ >= bytes)
+                offset = head_;
+            else if (tail > bytes) // 保留至少一個位元組區分滿與空
+                offset = 0;
+            else
+                return false;
+        }
+        else
+        {
+            if (tail - head_ <= bytes)
+                return false;
+            offset = head_;
+        }
+    }
+
+    head_ = offset + bytes;
+    regions_.push_back({offset, head_, nullptr});
+    return true;
+}
+
+const void *UploadRing::stage(const void *data, size_t bytes)
+{
+    size_t offset;
+    if (!allocate(bytes, offset))
+    {
+        fallbacks_++;
+        bind(false);
+        return data;
+    }
+
+    bind(true);
+    // 區段已確認不在 GPU 使用中，不需同步等待
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!dst)
+    {
+        regions_.pop_back();
+        head_ = regions_.empty() ? 0 : regions_.back().end;
+        fallbacks_++;
+        bind(false);
+        return data;
+    }
+    std::memcpy(dst, data, bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    stagedBytes_ += bytes;
+    return reinterpret_cast<const void *>(offset);
+}
+
+void UploadRing::fence()
+{
+    bool open = false;
+    for (auto &region : regions_)
+        open |= region.sync == nullptr;
+    if (open)
+    {
+        GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        for (auto &region : regions_)
+        {
+            if (!region.sync)
+                region.sync = sync;
+        }
+    }
+    bind(false);
+}
+
+size_t UploadRing::idleBytes()
+{
+    retire();
+    if (regions_.empty())
+        return capacity_;
+    const size_t tail = regions_.front().begin;
+    return head_ > tail ? capacity_ - (head_ - tail) : tail - head_;
+}
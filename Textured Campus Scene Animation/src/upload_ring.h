@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include "gl_handle.h"
+
+// 貼圖上傳用的 pixel unpack buffer 環形緩衝：資料先複製進映射的 PBO，
+// glTex(Sub)Image 改由 PBO 讀取（驅動程式可非同步 DMA），區段以 fence 追蹤，GPU 用完才重複使用
+// 所有函式需在 GL thread 呼叫
+class UploadRing {
+public:
+    explicit UploadRing(size_t capacity);
+    ~UploadRing();
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    // 把 data 複製進環中並綁定 PBO，回傳應傳給 glTex(Sub)Image 的指標（PBO 內位移）
+    // 空間仍被 GPU 使用中或 bytes 超過容量時解除 PBO 綁定並回傳 data（直接由用戶端記憶體上傳）
+    const void* stage(const void* data, size_t bytes);
+    // 本批 glTex* 已送出：插入 fence 並解除 PBO 綁定
+    void fence();
+
+    // 目前沒有被 GPU 佔用的空間（不計環繞造成的碎片）
+    size_t idleBytes();
+    size_t capacity() const { return capacity_; }
+
+    uint64_t stagedBytes() const { return stagedBytes_; }
+    size_t fallbacks() const { return fallbacks_; }
+
+private:
+    struct Region {
+        size_t begin = 0, end = 0;
+        void* sync = nullptr; // GLsync；nullptr = 尚未 fence
+    };
+
+    void retire();
+    bool allocate(size_t bytes, size_t& offset);
+    void bind(bool on);
+
+    GlBuffer pbo_;
+    size_t capacity_ = 0;
+    size_t head_ = 0;
+    std::deque<Region> regions_; // 依配置順序
+    uint64_t stagedBytes_ = 0;
+    size_t fallbacks_ = 0;
+};
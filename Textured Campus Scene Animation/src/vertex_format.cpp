@@ -0,0 +1,252 @@
+#include "vertex_format.h"
+#include <OpenGL/gl3.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 各格式內的 byte 位移
+struct Layout {
+    size_t stride;
+    size_t normalOffset;
+    size_t texOffset;
+    bool normal8;
+};
+
+Layout layoutOf(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Packed16:
+        return {16, 8, 12, false};
+    case VertexFormat::Packed8:
+        return {12, 6, 8, true};
+    default:
+        return {sizeof(Vertex), sizeof(glm::vec3), 2 * sizeof(glm::vec3), false};
+    }
+}
+
+uint16_t floatToHalf(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, 4);
+    uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t rawExp = (x >> 23) & 0xffu;
+    uint32_t mant = x & 0x7fffffu;
+
+    if (rawExp == 0xff)
+        return (uint16_t)(sign | 0x7c00u | (mant ? 0x200u : 0u)); // inf / nan
+
+    int exp = (int)rawExp - 127 + 15;
+    if (exp >= 31)
+        return (uint16_t)(sign | 0x7bffu); // 超出範圍：夾到最大有限值
+
+    if (exp <= 0)
+    {
+        // 次正規數
+        if (exp < -10)
+            return (uint16_t)sign;
+        mant |= 0x800000u;
+        uint32_t shift = (uint32_t)(14 - exp);
+        uint32_t h = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1)))
+            h++;
+        return (uint16_t)(sign | h);
+    }
+
+    uint32_t h = sign | ((uint32_t)exp << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fffu;
+    if (rem > 0x1000u || (rem == 0x1000u && (h & 1)))
+        h++; // 進位可自然溢入指數
+    if ((h & 0x7c00u) == 0x7c00u)
+        h = sign | 0x7bffu;
+    return (uint16_t)h;
+}
+
+float halfToFloat(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t exp = (h >> 10) & 0x1fu;
+    uint32_t mant = h & 0x3ffu;
+    float f;
+    if (exp == 0)
+    {
+        f = std::ldexp((float)mant, -24);
+        return sign ? -f : f;
+    }
+    uint32_t x = sign | ((exp == 31 ? 255u : exp - 15 + 127) << 23) | (mant << 13);
+    std::memcpy(&f, &x, 4);
+    return f;
+}
+
+// 八面體編碼，回傳 [-1, 1]^2
+glm::vec2 octEncode(glm::vec3 n)
+{
+    float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (sum <= 0.f)
+        return glm::vec2(0.f);
+    n /= sum;
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.f)
+    {
+        e = glm::vec2((1.f - std::fabs(n.y)) * (n.x >= 0.f ? 1.f : -1.f),
+                      (1.f - std::fabs(n.x)) * (n.y >= 0.f ? 1.f : -1.f));
+    }
+    return e;
+}
+
+// 與 vertex shader 中的 octDecode 相同
+glm::vec3 octDecode(glm::vec2 e)
+{
+    glm::vec3 n(e.x, e.y, 1.f - std::fabs(e.x) - std::fabs(e.y));
+    if (n.z < 0.f)
+    {
+        float x = (1.f - std::fabs(n.y)) * (n.x >= 0.f ? 1.f : -1.f);
+        float y = (1.f - std::fabs(n.x)) * (n.y >= 0.f ? 1.f : -1.f);
+        n.x = x;
+        n.y = y;
+    }
+    return glm::normalize(n);
+}
+
+} // namespace
+
+size_t vertexStride(VertexFormat format)
+{
+    return layoutOf(format).stride;
+}
+
+const void* vertexBytes(const MeshData& mesh)
+{
+    if (mesh.format == VertexFormat::Float32)
+        return mesh.vertices.data();
+    return mesh.packedVertices.data();
+}
+
+size_t vertexCount(const MeshData& mesh)
+{
+    if (mesh.format == VertexFormat::Float32)
+        return mesh.vertices.size();
+    return mesh.packedVertices.size() / vertexStride(mesh.format);
+}
+
+float octNormalScale(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Packed16:
+        return 1.0f / 32767.0f;
+    case VertexFormat::Packed8:
+        return 1.0f / 127.0f;
+    default:
+        return 0.0f;
+    }
+}
+
+void QuantizationError::merge(const QuantizationError& o)
+{
+    position = std::max(position, o.position);
+    normalDegrees = std::max(normalDegrees, o.normalDegrees);
+    texcoord = std::max(texcoord, o.texcoord);
+}
+
+QuantizationError quantizeMesh(MeshData& mesh, VertexFormat format)
+{
+    QuantizationError err;
+    if (format == VertexFormat::Float32 || mesh.vertices.empty())
+        return err;
+
+    const Layout layout = layoutOf(format);
+    const float normalMax = layout.normal8 ? 127.f : 32767.f;
+
+    // 以 mesh AABB 正規化位置
+    glm::vec3 mn(mesh.vertices[0].pos), mx(mesh.vertices[0].pos);
+    for (const auto& v : mesh.vertices)
+    {
+        mn = glm::min(mn, v.pos);
+        mx = glm::max(mx, v.pos);
+    }
+    glm::vec3 extent = mx - mn;
+    glm::vec3 inv(extent.x > 0.f ? 1.f / extent.x : 0.f,
+                  extent.y > 0.f ? 1.f / extent.y : 0.f,
+                  extent.z > 0.f ? 1.f / extent.z : 0.f);
+
+    mesh.packedVertices.assign(mesh.vertices.size() * layout.stride, 0);
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        const Vertex& v = mesh.vertices[i];
+        uint8_t* out = &mesh.packedVertices[i * layout.stride];
+
+        // 位置：unorm16
+        uint16_t p[3];
+        glm::vec3 decodedPos;
+        for (int k = 0; k < 3; k++)
+        {
+            float t = std::min(std::max((v.pos[k] - mn[k]) * inv[k], 0.f), 1.f);
+            p[k] = (uint16_t)std::lround(t * 65535.f);
+            decodedPos[k] = mn[k] + extent[k] * (p[k] / 65535.f);
+        }
+        std::memcpy(out, p, sizeof(p));
+        err.position = std::max(err.position, glm::length(decodedPos - v.pos));
+
+        // 法線：八面體編碼
+        glm::vec2 e = octEncode(v.normal);
+        glm::vec2 q(std::round(e.x * normalMax), std::round(e.y * normalMax));
+        if (layout.normal8)
+        {
+            int8_t n[2] = {(int8_t)q.x, (int8_t)q.y};
+            std::memcpy(out + layout.normalOffset, n, sizeof(n));
+        }
+        else
+        {
+            int16_t n[2] = {(int16_t)q.x, (int16_t)q.y};
+            std::memcpy(out + layout.normalOffset, n, sizeof(n));
+        }
+        float len = glm::length(v.normal);
+        if (len > 0.f)
+        {
+            glm::vec3 dn = octDecode(q / normalMax);
+            float c = std::min(std::max(glm::dot(dn, v.normal / len), -1.f), 1.f);
+            err.normalDegrees = std::max(err.normalDegrees, glm::degrees(std::acos(c)));
+        }
+
+        // UV：half float
+        uint16_t t[2] = {floatToHalf(v.tex.x), floatToHalf(v.tex.y)};
+        std::memcpy(out + layout.texOffset, t, sizeof(t));
+        err.texcoord = std::max(err.texcoord, std::max(std::fabs(halfToFloat(t[0]) - v.tex.x),
+                                                       std::fabs(halfToFloat(t[1]) - v.tex.y)));
+    }
+
+    mesh.format = format;
+    mesh.posOffset = mn;
+    mesh.posScale = extent;
+    std::vector<Vertex>().swap(mesh.vertices);
+    return err;
+}
+
+void setupVertexAttributes(VertexFormat format)
+{
+    const Layout layout = layoutOf(format);
+    const GLsizei stride = (GLsizei)layout.stride;
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    if (format == VertexFormat::Float32)
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)layout.normalOffset);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)layout.texOffset);
+        return;
+    }
+
+    // 位置以 unorm 讀入 [0,1]；法線以整數值讀入，由 shader 乘上 uOctNormalScale
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+    glVertexAttribPointer(1, 2, layout.normal8 ? GL_BYTE : GL_SHORT, GL_FALSE, stride,
+                          (void*)layout.normalOffset);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)layout.texOffset);
+}
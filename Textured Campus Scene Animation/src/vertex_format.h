@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include "mesh_data.h"
+
+size_t vertexStride(VertexFormat format);
+
+// 目前 GPU 頂點資料（依 format 取 vertices 或 packedVertices）
+const void* vertexBytes(const MeshData& mesh);
+size_t vertexCount(const MeshData& mesh);
+
+// 量化最大誤差
+struct QuantizationError {
+    float position = 0.f;      // 世界座標單位
+    float normalDegrees = 0.f; // 角度
+    float texcoord = 0.f;      // UV 單位
+
+    void merge(const QuantizationError& o);
+};
+
+// 將 mesh.vertices 依 format 量化到 packedVertices（以 mesh AABB 為基準）
+QuantizationError quantizeMesh(MeshData& mesh, VertexFormat format);
+
+// 對目前綁定的 VBO 設定 attribute 0/1/2
+void setupVertexAttributes(VertexFormat format);
+
+// shader 解碼法線用的縮放（0 表示法線未壓縮）
+float octNormalScale(VertexFormat format);
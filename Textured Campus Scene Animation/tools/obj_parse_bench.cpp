@@ -0,0 +1,159 @@
+// OBJ 解析效能比較：tinyobj::ObjReader vs FastObjReader（一次解析與串流）
+//
+// 用法：obj_parse_bench [--synthetic-mb N] [--runs N] [file.obj ...]
+// 未指定檔案時只測合成檔；合成檔為 N MB 的網格（含 v / vt / vn / f）。
+#include "obj_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// 產生約 targetMB 大小的合成網格
+static std::string writeSyntheticObj(size_t targetMB)
+{
+    std::string path = (fs::temp_directory_path() / "obj_parse_bench_synthetic.obj").string();
+    std::ofstream out(path);
+    // 每個格點約 120 bytes（v + vt + vn + 一個 quad 面）
+    size_t n = (size_t)std::sqrt((double)targetMB * 1024 * 1024 / 120.0);
+    n = std::max<size_t>(n, 2);
+    char line[128];
+    for (size_t z = 0; z < n; z++)
+        for (size_t x = 0; x < n; x++)
+        {
+            float fx = (float)x / n, fz = (float)z / n;
+            std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", fx * 100.f, std::sin(fx * 20.f) * std::cos(fz * 20.f), fz * 100.f);
+            out << line;
+            std::snprintf(line, sizeof(line), "vt %.6f %.6f\n", fx, fz);
+            out << line;
+            std::snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", 0.0f, 1.0f, 0.0f);
+            out << line;
+        }
+    out << "g grid\n";
+    for (size_t z = 0; z + 1 < n; z++)
+        for (size_t x = 0; x + 1 < n; x++)
+        {
+            size_t a = z * n + x + 1, b = a + 1, c = a + n + 1, d = a + n;
+            std::snprintf(line, sizeof(line), "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n",
+                          a, a, a, b, b, b, c, c, c, d, d, d);
+            out << line;
+        }
+    return path;
+}
+
+template <typename Fn>
+static double bestSeconds(int runs, Fn fn)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+static size_t indexCount(const std::vector<tinyobj::shape_t>& shapes)
+{
+    size_t n = 0;
+    for (const auto& s : shapes)
+        n += s.mesh.indices.size();
+    return n;
+}
+
+static bool bench(const std::string& path, int runs)
+{
+    double mb = (double)fs::file_size(path) / (1024.0 * 1024.0);
+
+    tinyobj::ObjReader ref;
+    double tRef = bestSeconds(runs, [&] { ref.ParseFromFile(path); });
+    FastObjReader fast;
+    double tFast = bestSeconds(runs, [&] { fast.ParseFromFile(path); });
+
+    // 串流：計時只數索引，之後另跑一次收集索引與一次解析的結果逐一比對
+    FastObjReader stream;
+    size_t streamed = 0;
+    FastObjCallbacks count;
+    count.triangles = [&](const tinyobj::index_t*, size_t n, const tinyobj::attrib_t&) { streamed += n; };
+    double tStream = bestSeconds(runs, [&] {
+        streamed = 0;
+        stream.StreamFromFile(path, count);
+    });
+    std::vector<tinyobj::index_t> corners;
+    FastObjCallbacks collect;
+    collect.triangles = [&](const tinyobj::index_t* c, size_t n, const tinyobj::attrib_t&) {
+        corners.insert(corners.end(), c, c + n);
+    };
+    stream.StreamFromFile(path, collect);
+
+    if (!ref.Valid() || !fast.Valid() || !stream.Valid())
+    {
+        std::fprintf(stderr, "Failed to parse %s\n", path.c_str());
+        return false;
+    }
+
+    bool same = ref.GetAttrib().vertices.size() == fast.GetAttrib().vertices.size() &&
+                ref.GetAttrib().normals.size() == fast.GetAttrib().normals.size() &&
+                ref.GetAttrib().texcoords.size() == fast.GetAttrib().texcoords.size() &&
+                ref.GetShapes().size() == fast.GetShapes().size() &&
+                indexCount(ref.GetShapes()) == indexCount(fast.GetShapes());
+
+    std::vector<tinyobj::index_t> parsed;
+    for (const auto& shape : fast.GetShapes())
+        parsed.insert(parsed.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+    bool streamSame = stream.GetAttrib().vertices == fast.GetAttrib().vertices &&
+                      stream.GetAttrib().normals == fast.GetAttrib().normals &&
+                      stream.GetAttrib().texcoords == fast.GetAttrib().texcoords &&
+                      corners.size() == parsed.size() && streamed == parsed.size() &&
+                      std::equal(corners.begin(), corners.end(), parsed.begin(),
+                                 [](const tinyobj::index_t& a, const tinyobj::index_t& b) {
+                                     return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index &&
+                                            a.texcoord_index == b.texcoord_index;
+                                 });
+
+    std::printf("%s (%.1f MB)\n", path.c_str(), mb);
+    std::printf("  tinyobj    : %8.1f ms  %8.1f MB/s\n", tRef * 1e3, mb / tRef);
+    std::printf("  FastObj    : %8.1f ms  %8.1f MB/s  (x%.2f)\n", tFast * 1e3, mb / tFast, tRef / tFast);
+    std::printf("  FastStream : %8.1f ms  %8.1f MB/s  (x%.2f)\n", tStream * 1e3, mb / tStream, tRef / tStream);
+    std::printf("  output     : %s, stream %s\n", same ? "match" : "MISMATCH", streamSame ? "match" : "MISMATCH");
+    return same && streamSame;
+}
+
+int main(int argc, char** argv)
+{
+    size_t syntheticMB = 64;
+    int runs = 3;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!std::strcmp(argv[i], "--synthetic-mb") && i + 1 < argc)
+            syntheticMB = (size_t)std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--runs") && i + 1 < argc)
+            runs = std::max(1, std::atoi(argv[++i]));
+        else
+            files.push_back(argv[i]);
+    }
+
+    bool ok = true;
+    for (const auto& f : files)
+        ok &= bench(f, runs);
+
+    if (syntheticMB > 0)
+    {
+        std::string synthetic = writeSyntheticObj(syntheticMB);
+        ok &= bench(synthetic, runs);
+        std::error_code ec;
+        fs::remove(synthetic, ec);
+    }
+    return ok ? 0 : 1;
+}